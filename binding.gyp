@@ -5,6 +5,7 @@
       'include_dirs': [ "<!(node -e \"require('nan')\")" ],
       'sources': [
         'src/binding.cc',
+        'src/parallel.cc',
       ],
       'dependencies': [
         'deps/libvorbis/libvorbis.gyp:libvorbis',
@@ -0,0 +1,1163 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2010             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: microbenchmarks for libvorbis internals
+
+ Usage: bench [-j] [-f file.ogg] [case ...]
+ With no case names every case is run.  -j prints the results as
+ JSON instead, for diffing one build against another; -f takes the
+ packets for the decode cases from the first Vorbis stream in an Ogg
+ file rather than from encoding the synthetic input below.
+
+ ********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ogg/ogg.h>
+#include "vorbis/codec.h"
+#include "vorbis/vorbisenc.h"
+#include "codec_internal.h"
+#include "mdct.h"
+#include "smallft.h"
+#include "bitread.h"
+#include "registry.h"
+#include "simd.h"
+
+/* the vector code the library was built with */
+#if !defined(VORBIS_SIMD)
+#define SIMD_STRING "none"
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SIMD_STRING "neon"
+#else
+#define SIMD_STRING "sse2"
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#endif
+
+/* timing ***********************************************************/
+
+static double now(void){
+#ifdef _WIN32
+  LARGE_INTEGER f,c;
+  QueryPerformanceFrequency(&f);
+  QueryPerformanceCounter(&c);
+  return (double)c.QuadPart/(double)f.QuadPart;
+#else
+  struct timeval tv;
+  gettimeofday(&tv,NULL);
+  return tv.tv_sec+tv.tv_usec*1e-6;
+#endif
+}
+
+/* results **********************************************************/
+
+static int json=0;
+static int results=0;
+
+/* one line (or JSON object) per timed function: the time one call
+   takes and, where it means something, how many samples a call gets
+   through; further figures can follow with report_extra() */
+static void report(const char *name,double ns,double samples){
+  if(results)printf(json?"},\n":"\n");
+  if(json){
+    printf("    {\"name\": \"%s\", \"ns_per_call\": %.1f, "
+           "\"samples_per_sec\": ",name,ns);
+    if(samples>0)
+      printf("%.0f",samples*1e9/ns);
+    else
+      printf("null");
+  }else{
+    printf("%s: %.1f ns/call",name,ns);
+    if(samples>0)printf(", %.2f Msamples/s",samples*1e3/ns);
+  }
+  results++;
+}
+
+static void report_extra(const char *key,double value){
+  if(json)
+    printf(", \"%s\": %.6g",key,value);
+  else
+    printf(", %s %.6g",key,value);
+}
+
+static void json_string(const char *s){
+  putchar('"');
+  for(;*s;s++){
+    if(*s=='"' || *s=='\\')putchar('\\');
+    if((unsigned char)*s>=0x20)putchar(*s);
+  }
+  putchar('"');
+}
+
+static void report_begin(const char *input){
+  if(!json)return;
+  printf("{\n  \"version\": ");
+  json_string(vorbis_version_string());
+  printf(",\n  \"simd\": ");
+  json_string(SIMD_STRING);
+  printf(",\n  \"input\": ");
+  json_string(input);
+  printf(",\n  \"results\": [\n");
+}
+
+static void report_end(void){
+  if(results)printf(json?"}\n":"\n");
+  if(json)printf("  ]\n}\n");
+}
+
+/* synthetic input **************************************************/
+
+static unsigned int bench_seed=0x5eed;
+
+static float noise(void){
+  bench_seed=bench_seed*1103515245u+12345u;
+  return ((bench_seed>>8)&0xffff)/32768.f-1.f;
+}
+
+/* a few tones, some noise and a periodic click so that the encoder
+   exercises both block sizes */
+static void synth(float **pcm,int ch,long offset,long n){
+  long i;
+  int j;
+  for(i=0;i<n;i++){
+    long t=offset+i;
+    for(j=0;j<ch;j++){
+      float s=.3f*sin(t*(.01+j*.003))+.1f*sin(t*.2*(1+j))+.05f*noise();
+      if((t%20000)<300 && (t/20000)%3==1)s+=.6f*noise();
+      pcm[j][i]=s;
+    }
+  }
+}
+
+/* encoder setup shared by the analysis cases */
+typedef struct {
+  vorbis_info      vi;
+  vorbis_comment   vc;
+  vorbis_dsp_state vd;
+  vorbis_block     vb;
+  ogg_packet       header[3];
+  long             fed;
+} bench_encoder;
+
+static int encoder_open(bench_encoder *e,int ch,long rate,float quality){
+  memset(e,0,sizeof(*e));
+  vorbis_info_init(&e->vi);
+  if(vorbis_encode_init_vbr(&e->vi,ch,rate,quality))return -1;
+  vorbis_comment_init(&e->vc);
+  vorbis_analysis_init(&e->vd,&e->vi);
+  vorbis_block_init(&e->vd,&e->vb);
+  vorbis_analysis_headerout(&e->vd,&e->vc,
+                            e->header,e->header+1,e->header+2);
+  return 0;
+}
+
+static void encoder_feed(bench_encoder *e,long n){
+  float **buf=vorbis_analysis_buffer(&e->vd,n);
+  synth(buf,e->vi.channels,e->fed,n);
+  vorbis_analysis_wrote(&e->vd,n);
+  e->fed+=n;
+}
+
+static void encoder_close(bench_encoder *e){
+  vorbis_block_clear(&e->vb);
+  vorbis_dsp_clear(&e->vd);
+  vorbis_comment_clear(&e->vc);
+  vorbis_info_clear(&e->vi);
+}
+
+/* packets for the decode cases: the synthetic input through the
+   encoder, or the first Vorbis stream of the file given with -f */
+typedef struct {
+  ogg_packet *packet;
+  long        packets;
+  long        storage;
+} bench_stream;
+
+static const char *stream_file=NULL;
+static bench_stream stream;
+
+static void stream_add(bench_stream *s,ogg_packet *op){
+  ogg_packet *p;
+  if(s->packets==s->storage){
+    s->storage=s->storage?s->storage*2:64;
+    s->packet=realloc(s->packet,s->storage*sizeof(*s->packet));
+  }
+  p=s->packet+s->packets++;
+  *p=*op;
+  p->packet=malloc(op->bytes>0?op->bytes:1);
+  memcpy(p->packet,op->packet,op->bytes);
+}
+
+static void stream_clear(bench_stream *s){
+  long i;
+  for(i=0;i<s->packets;i++)free(s->packet[i].packet);
+  free(s->packet);
+  memset(s,0,sizeof(*s));
+}
+
+static int stream_encode(bench_stream *s){
+  bench_encoder e;
+  ogg_packet op;
+  int i,last=0;
+
+  if(encoder_open(&e,2,44100,.4f))return -1;
+  for(i=0;i<3;i++)stream_add(s,e.header+i);
+  while(!last){
+    if(e.fed<44100*10)
+      encoder_feed(&e,1024);
+    else{
+      vorbis_analysis_wrote(&e.vd,0);
+      last=1;
+    }
+    while(vorbis_analysis_blockout(&e.vd,&e.vb)==1){
+      vorbis_analysis(&e.vb,NULL);
+      vorbis_bitrate_addblock(&e.vb);
+      while(vorbis_bitrate_flushpacket(&e.vd,&op))stream_add(s,&op);
+    }
+  }
+  encoder_close(&e);
+  return 0;
+}
+
+static int stream_read(bench_stream *s,const char *path){
+  FILE *f=fopen(path,"rb");
+  ogg_sync_state oy;
+  ogg_stream_state os;
+  ogg_page og;
+  ogg_packet op;
+  int found=0,eos=0,ret;
+
+  if(!f)return -1;
+  ogg_sync_init(&oy);
+  while(!eos){
+    char *buf=ogg_sync_buffer(&oy,4096);
+    long bytes=fread(buf,1,4096,f);
+    if(bytes<=0)break;
+    ogg_sync_wrote(&oy,bytes);
+
+    while(!eos && ogg_sync_pageout(&oy,&og)==1){
+      if(!found){
+        if(!ogg_page_bos(&og))continue;
+        ogg_stream_init(&os,ogg_page_serialno(&og));
+        ogg_stream_pagein(&os,&og);
+        if(ogg_stream_packetout(&os,&op)!=1 ||
+           !vorbis_synthesis_idheader(&op)){
+          ogg_stream_clear(&os);
+          continue;
+        }
+        found=1;
+        stream_add(s,&op);
+      }else if(ogg_stream_pagein(&os,&og))
+        continue; /* some other stream's page */
+
+      while((ret=ogg_stream_packetout(&os,&op))!=0)
+        if(ret==1)stream_add(s,&op);
+      eos=ogg_page_eos(&og);
+    }
+  }
+
+  if(found)ogg_stream_clear(&os);
+  ogg_sync_clear(&oy);
+  fclose(f);
+  return s->packets>3?0:-1;
+}
+
+/* the shared packets, made or read on first use */
+static bench_stream *stream_get(void){
+  static int tried=0;
+  if(!tried){
+    tried=1;
+    if(stream_file?stream_read(&stream,stream_file):stream_encode(&stream)){
+      fprintf(stderr,"bench: no Vorbis stream in %s\n",
+              stream_file?stream_file:"the encoder output");
+      stream_clear(&stream);
+    }
+  }
+  return stream.packets?&stream:NULL;
+}
+
+static const char *stream_name(void){
+  return stream_file?stream_file:"synthetic";
+}
+
+typedef struct {
+  vorbis_info      vi;
+  vorbis_comment   vc;
+  vorbis_dsp_state vd;
+  vorbis_block     vb;
+} bench_decoder;
+
+static int decoder_open(bench_decoder *d,bench_stream *s){
+  int i;
+  memset(d,0,sizeof(*d));
+  vorbis_info_init(&d->vi);
+  vorbis_comment_init(&d->vc);
+  for(i=0;i<3;i++){
+    if(vorbis_synthesis_headerin(&d->vi,&d->vc,s->packet+i)){
+      vorbis_comment_clear(&d->vc);
+      vorbis_info_clear(&d->vi);
+      return -1;
+    }
+  }
+  vorbis_synthesis_init(&d->vd,&d->vi);
+  vorbis_block_init(&d->vd,&d->vb);
+  return 0;
+}
+
+static void decoder_close(bench_decoder *d){
+  vorbis_block_clear(&d->vb);
+  vorbis_dsp_clear(&d->vd);
+  vorbis_comment_clear(&d->vc);
+  vorbis_info_clear(&d->vi);
+}
+
+/* what vorbis_synthesis() and mapping0_inverse() do with a packet up
+   to the residue: the block is set up, each channel's floor is read
+   into memo[] and its spectrum cleared.  Returns the mapping, or NULL
+   for a packet that isn't audio */
+static vorbis_info_mapping0 *decoder_floors(bench_decoder *d,ogg_packet *op,
+                                            void **memo,int *nonzero){
+  vorbis_block *vb=&d->vb;
+  private_state *b=d->vd.backend_state;
+  codec_setup_info *ci=d->vi.codec_setup;
+  vorbis_info_mapping0 *info;
+  int mode,i;
+
+  _vorbis_block_ripcord(vb);
+  oggpack_readinit(&vb->opb,op->packet,op->bytes);
+  if(oggpack_read(&vb->opb,1)!=0)return NULL;
+  mode=oggpack_read(&vb->opb,b->modebits);
+  if(mode<0 || !ci->mode_param[mode])return NULL;
+
+  vb->mode=mode;
+  vb->W=ci->mode_param[mode]->blockflag;
+  vb->lW=vb->nW=0;
+  if(vb->W){
+    vb->lW=oggpack_read(&vb->opb,1);
+    vb->nW=oggpack_read(&vb->opb,1);
+  }
+  vb->pcmend=ci->blocksizes[vb->W];
+  vb->pcm=_vorbis_block_alloc(vb,sizeof(*vb->pcm)*d->vi.channels);
+
+  info=(vorbis_info_mapping0 *)ci->map_param[ci->mode_param[mode]->mapping];
+  for(i=0;i<d->vi.channels;i++){
+    int submap=info->chmuxlist[i];
+    vb->pcm[i]=_vorbis_block_alloc(vb,vb->pcmend*sizeof(*vb->pcm[i]));
+    memo[i]=_floor_P[ci->floor_type[info->floorsubmap[submap]]]->
+      inverse1(vb,b->flr[info->floorsubmap[submap]]);
+    nonzero[i]=memo[i]!=NULL;
+    memset(vb->pcm[i],0,sizeof(*vb->pcm[i])*vb->pcmend/2);
+  }
+  for(i=0;i<info->coupling_steps;i++){
+    if(nonzero[info->coupling_mag[i]] || nonzero[info->coupling_ang[i]]){
+      nonzero[info->coupling_mag[i]]=1;
+      nonzero[info->coupling_ang[i]]=1;
+    }
+  }
+  return info;
+}
+
+/* 1 if the stream has long blocks, else 0; the floor and residue
+   cases time the blocks of that size */
+static int decoder_blockflag(bench_decoder *d,bench_stream *s){
+  private_state *b=d->vd.backend_state;
+  codec_setup_info *ci=d->vi.codec_setup;
+  oggpack_buffer opb;
+  long p;
+  int mode;
+
+  for(p=3;p<s->packets;p++){
+    oggpack_readinit(&opb,s->packet[p].packet,s->packet[p].bytes);
+    if(oggpack_read(&opb,1)!=0)continue;
+    mode=oggpack_read(&opb,b->modebits);
+    if(mode>=0 && ci->mode_param[mode] && ci->mode_param[mode]->blockflag)
+      return 1;
+  }
+  return 0;
+}
+
+/* the residue stage of mapping0_inverse(), from where decoder_floors()
+   left the packet */
+static void decoder_residue(bench_decoder *d,vorbis_info_mapping0 *info,
+                            int *nonzero,float **pcmbundle,int *zerobundle){
+  codec_setup_info *ci=d->vi.codec_setup;
+  private_state *b=d->vd.backend_state;
+  int i,j;
+
+  for(i=0;i<info->submaps;i++){
+    int ch_in_bundle=0;
+    for(j=0;j<d->vi.channels;j++){
+      if(info->chmuxlist[j]==i){
+        zerobundle[ch_in_bundle]=nonzero[j];
+        pcmbundle[ch_in_bundle++]=d->vb.pcm[j];
+      }
+    }
+    _residue_P[ci->residue_type[info->residuesubmap[i]]]->
+      inverse(&d->vb,b->residue[info->residuesubmap[i]],
+              pcmbundle,zerobundle,ch_in_bundle);
+  }
+}
+
+/* cases ************************************************************/
+
+/* bytes drawn from the vorbis_block arena by vorbis_analysis(); the
+   forward path keeps its working vectors in the block internals, so
+   this should stay at zero */
+static void bench_analysis_alloc(void){
+  bench_encoder e;
+  ogg_packet op;
+  long blocks=0,bytes=0,allocs=0;
+  double t0,spent=0;
+
+  if(encoder_open(&e,2,44100,.4f))return;
+
+  while(e.fed<44100*20){
+    encoder_feed(&e,1024);
+    while(vorbis_analysis_blockout(&e.vd,&e.vb)==1){
+      long before=e.vb.totaluse+e.vb.localtop,after;
+      t0=now();
+      vorbis_analysis(&e.vb,NULL);
+      spent+=now()-t0;
+      after=e.vb.totaluse+e.vb.localtop;
+      if(after!=before)allocs++;
+      bytes+=after-before;
+      blocks++;
+      vorbis_bitrate_addblock(&e.vb);
+      while(vorbis_bitrate_flushpacket(&e.vd,&op));
+    }
+  }
+
+  report("vorbis_analysis",spent*1e9/blocks,0);
+  report_extra("arena_bytes_per_block",(double)bytes/blocks);
+  report_extra("blocks_allocating",allocs);
+  encoder_close(&e);
+}
+
+/* forward and inverse MDCT at the usual short and long blocksizes;
+   best of a few rounds, to keep out scheduling noise */
+static void bench_mdct_n(int n){
+  mdct_lookup m;
+  float *in=malloc(n*sizeof(*in));
+  float *out=malloc(n*sizeof(*out));
+  long i,iters=(1<<22)/n;
+  double t0,t,fwd=1e9,bwd=1e9;
+  int round;
+  char name[64];
+
+  mdct_init(&m,n);
+  for(i=0;i<n;i++)in[i]=noise();
+
+  for(round=0;round<5;round++){
+    t0=now();
+    for(i=0;i<iters;i++)mdct_forward(&m,in,out);
+    t=now()-t0;
+    if(t<fwd)fwd=t;
+
+    t0=now();
+    for(i=0;i<iters;i++)mdct_backward(&m,in,out);
+    t=now()-t0;
+    if(t<bwd)bwd=t;
+  }
+
+  sprintf(name,"mdct_forward_%d",n);
+  report(name,fwd*1e9/iters,n/2);
+  sprintf(name,"mdct_backward_%d",n);
+  report(name,bwd*1e9/iters,n/2);
+  mdct_clear(&m);
+  free(in);
+  free(out);
+}
+
+static void bench_mdct(void){
+  bench_mdct_n(256);
+  bench_mdct_n(2048);
+}
+
+/* the real FFT behind the encoder's tonal analysis, at the same sizes */
+static void bench_fft_n(int n){
+  drft_lookup l;
+  float *in=malloc(n*sizeof(*in));
+  float *buf=malloc(n*sizeof(*buf));
+  long i,iters=(1<<22)/n;
+  double t0,t,best=1e9;
+  int round;
+  char name[64];
+
+  drft_init(&l,n);
+  for(i=0;i<n;i++)in[i]=noise();
+
+  for(round=0;round<5;round++){
+    t0=now();
+    for(i=0;i<iters;i++){
+      memcpy(buf,in,n*sizeof(*buf));
+      drft_forward(&l,buf);
+    }
+    t=now()-t0;
+    if(t<best)best=t;
+  }
+
+  sprintf(name,"drft_forward_%d",n);
+  report(name,best*1e9/iters,n);
+  drft_clear(&l);
+  free(in);
+  free(buf);
+}
+
+static void bench_fft(void){
+  bench_fft_n(256);
+  bench_fft_n(2048);
+}
+
+/* codeword-sized look+advance pairs over a packet, through libogg and
+   through the inline reader codebook.c uses */
+#define BITREAD_BYTES 65536
+#define BITREAD_READS 16384
+
+static unsigned long bitread_ogg(unsigned char *buf,const int *len){
+  oggpack_buffer b;
+  unsigned long sum=0;
+  int i;
+  oggpack_readinit(&b,buf,BITREAD_BYTES);
+  for(i=0;i<BITREAD_READS;i++){
+    sum+=oggpack_look(&b,len[i]);
+    oggpack_adv(&b,len[i]);
+  }
+  return sum;
+}
+
+static unsigned long bitread_inline(unsigned char *buf,const int *len){
+  oggpack_buffer b;
+  unsigned long sum=0;
+  int i;
+  oggpack_readinit(&b,buf,BITREAD_BYTES);
+  for(i=0;i<BITREAD_READS;i++){
+    sum+=_oggpack_look(&b,len[i]);
+    _oggpack_adv(&b,len[i]);
+  }
+  return sum;
+}
+
+static void bench_bitread(void){
+  unsigned char *buf=malloc(BITREAD_BYTES);
+  int *len=malloc(BITREAD_READS*sizeof(*len));
+  unsigned long a=0,b=0;
+  double t0,t,ogg=1e9,inl=1e9;
+  int i,round;
+
+  for(i=0;i<BITREAD_BYTES;i++){
+    noise();
+    buf[i]=(unsigned char)(bench_seed>>16);
+  }
+  for(i=0;i<BITREAD_READS;i++)len[i]=1+(int)((noise()+1.f)*10.f);
+
+  for(round=0;round<5;round++){
+    t0=now();
+    for(i=0;i<100;i++)a+=bitread_ogg(buf,len);
+    t=now()-t0;
+    if(t<ogg)ogg=t;
+
+    t0=now();
+    for(i=0;i<100;i++)b+=bitread_inline(buf,len);
+    t=now()-t0;
+    if(t<inl)inl=t;
+  }
+
+  if(a!=b)fprintf(stderr,"bitread: results differ!\n");
+  report("oggpack_look_adv",ogg*1e9/(100.*BITREAD_READS),0);
+  report("_oggpack_look_adv",inl*1e9/(100.*BITREAD_READS),0);
+  free(buf);
+  free(len);
+}
+
+/* inverse channel coupling over a long block's worth of coefficients,
+   with random signs as real audio has them */
+static void bench_decouple(void){
+  long n=1024;
+  float *mag=malloc(n*sizeof(*mag));
+  float *ang=malloc(n*sizeof(*ang));
+  float *m=malloc(n*sizeof(*m));
+  float *a=malloc(n*sizeof(*a));
+  long i,iters=4096;
+  double t0,t,best=1e9;
+  int round;
+  char name[64];
+
+  for(i=0;i<n;i++){
+    mag[i]=noise();
+    ang[i]=noise();
+  }
+
+  for(round=0;round<5;round++){
+    t0=now();
+    for(i=0;i<iters;i++){
+      memcpy(m,mag,n*sizeof(*m));
+      memcpy(a,ang,n*sizeof(*a));
+      mapping0_decouple(m,a,n);
+    }
+    t=now()-t0;
+    if(t<best)best=t;
+  }
+
+  sprintf(name,"mapping0_decouple_%ld",n);
+  report(name,best*1e9/iters,2*n);
+  free(mag);
+  free(ang);
+  free(m);
+  free(a);
+}
+
+/* the encoder's noise and tone masking curves for one long block, on
+   a spectrum with some peaks standing out of the noise */
+static void bench_psy(void){
+  bench_encoder e;
+  vorbis_look_psy *p;
+  float *logmdct,*noisemask,*tonemask;
+  long i,n,iters=2048;
+  double t0,t,noise_t=1e9,tone_t=1e9;
+  int round;
+  char name[64];
+
+  if(encoder_open(&e,2,44100,.4f))return;
+  p=((private_state *)e.vd.backend_state)->psy+2;
+  n=p->n;
+
+  logmdct=malloc(n*sizeof(*logmdct));
+  noisemask=malloc(n*sizeof(*noisemask));
+  tonemask=malloc(n*sizeof(*tonemask));
+  for(i=0;i<n;i++){
+    logmdct[i]=-70.f+15.f*noise();
+    if(i%37==0)logmdct[i]+=40.f;
+  }
+
+  for(round=0;round<5;round++){
+    t0=now();
+    for(i=0;i<iters;i++)_vp_noisemask(p,logmdct,noisemask);
+    t=now()-t0;
+    if(t<noise_t)noise_t=t;
+
+    t0=now();
+    for(i=0;i<iters;i++)_vp_tonemask(p,logmdct,tonemask,-20.f,-20.f);
+    t=now()-t0;
+    if(t<tone_t)tone_t=t;
+  }
+
+  sprintf(name,"_vp_noisemask_%ld",n);
+  report(name,noise_t*1e9/iters,n);
+  sprintf(name,"_vp_tonemask_%ld",n);
+  report(name,tone_t*1e9/iters,n);
+  free(logmdct);
+  free(noisemask);
+  free(tonemask);
+  encoder_close(&e);
+}
+
+/* the encoder's floor fit for one long block, on a masking curve with
+   some bumps for the post search to chase */
+static void bench_floor1(void){
+  bench_encoder e;
+  codec_setup_info *ci;
+  private_state *b;
+  vorbis_look_floor1 *look=NULL;
+  float *logmdct,*logmask;
+  int post[VIF_POSIT+2];
+  long i,n,iters=4096;
+  double t0,t,best=1e9;
+  int round;
+  char name[64];
+
+  if(encoder_open(&e,2,44100,.4f))return;
+  ci=e.vi.codec_setup;
+  b=e.vd.backend_state;
+  for(i=0;i<ci->floors;i++){
+    vorbis_look_floor1 *l=(vorbis_look_floor1 *)b->flr[i];
+    if(!look || l->n>look->n)look=l;
+  }
+  n=look->n;
+
+  logmdct=malloc(n*sizeof(*logmdct));
+  logmask=malloc(n*sizeof(*logmask));
+  for(i=0;i<n;i++){
+    logmask[i]=-40.f-50.f*i/n+8.f*sin(i*.04)+4.f*sin(i*.31);
+    logmdct[i]=logmask[i]+12.f*noise();
+  }
+
+  for(round=0;round<5;round++){
+    t0=now();
+    for(i=0;i<iters;i++)floor1_fit(&e.vb,look,logmdct,logmask,post);
+    t=now()-t0;
+    if(t<best)best=t;
+  }
+
+  sprintf(name,"floor1_fit_%ld",n);
+  report(name,best*1e9/iters,n);
+  free(logmdct);
+  free(logmask);
+  encoder_close(&e);
+}
+
+/* the transient detector's filter bank over a few long blocks' worth
+   of stereo input, rewound before every pass */
+static void bench_envelope(void){
+  bench_encoder e;
+  envelope_lookup *ve;
+  long i,samples,iters=512;
+  double t0,t,best=1e9;
+  int round;
+
+  if(encoder_open(&e,2,44100,.4f))return;
+  encoder_feed(&e,8192);
+  ve=((private_state *)e.vd.backend_state)->ve;
+  samples=(e.vd.pcm_current/ve->searchstep-VE_WIN)*ve->searchstep;
+
+  for(round=0;round<5;round++){
+    t0=now();
+    for(i=0;i<iters;i++){
+      ve->current=0;
+      _ve_envelope_search(&e.vd);
+    }
+    t=now()-t0;
+    if(t<best)best=t;
+  }
+
+  report("_ve_envelope_search",best*1e9/iters,samples*e.vi.channels);
+  encoder_close(&e);
+}
+
+/* the encoder's channel coupling and noise normalization for one long
+   stereo block, at the middle one of the bitrate blobs; iwork brings
+   in the quantized floor and leaves with the quantized residue, so it
+   is put back before every call */
+static void bench_couple(void){
+  bench_encoder e;
+  codec_setup_info *ci;
+  vorbis_look_psy *p;
+  vorbis_info_mapping0 *info=NULL;
+  float *mdct[2];
+  int *iwork[2],*ifloor[2];
+  int nonzero[2];
+  long i,n,iters=2048;
+  double t0,t,best=1e9;
+  int j,round;
+  char name[64];
+
+  if(encoder_open(&e,2,44100,.4f))return;
+  ci=e.vi.codec_setup;
+  p=((private_state *)e.vd.backend_state)->psy+2;
+  n=p->n;
+  for(i=0;i<ci->modes;i++)
+    if(ci->mode_param[i]->blockflag)
+      info=(vorbis_info_mapping0 *)ci->map_param[ci->mode_param[i]->mapping];
+
+  for(j=0;j<2;j++){
+    mdct[j]=malloc(n*sizeof(**mdct));
+    iwork[j]=malloc(n*sizeof(**iwork));
+    ifloor[j]=malloc(n*sizeof(**ifloor));
+    nonzero[j]=1;
+  }
+  for(i=0;i<n;i++){
+    /* a floor falling from -40 to -100dB, and channels alike enough to
+       be worth coupling */
+    float amp;
+    ifloor[0][i]=ifloor[1][i]=(int)(182-110*i/n+4*noise());
+    amp=pow(10.,(ifloor[0][i]-255)*.0275);
+    mdct[0][i]=amp*4.f*noise();
+    mdct[1][i]=.8f*mdct[0][i]+amp*noise();
+  }
+
+  for(round=0;round<5;round++){
+    t0=now();
+    for(i=0;i<iters;i++){
+      memcpy(iwork[0],ifloor[0],n*sizeof(**iwork));
+      memcpy(iwork[1],ifloor[1],n*sizeof(**iwork));
+      _vp_couple_quantize_normalize(PACKETBLOBS/2,&ci->psy_g_param,p,info,
+                                    mdct,iwork,nonzero,
+                                    ci->psy_g_param.sliding_lowpass[1][PACKETBLOBS/2],
+                                    2);
+    }
+    t=now()-t0;
+    if(t<best)best=t;
+  }
+
+  sprintf(name,"_vp_couple_quantize_normalize_%ld",n);
+  report(name,best*1e9/iters,2*n);
+  for(j=0;j<2;j++){
+    free(mdct[j]);
+    free(iwork[j]);
+    free(ifloor[j]);
+  }
+  encoder_close(&e);
+}
+
+/* codebook decode: vorbis_book_decodev_add() as the residue calls it,
+   a partition of 32 values at a time, with the largest of the
+   encoder's books of each dimension, and the scalar
+   vorbis_book_decode() of the floor and the residue classifications.
+   The codewords are random ones of the entries the book uses */
+#define BOOK_WORDS 4096
+
+static void bench_book(codebook *enc,const static_codebook *s,int vector){
+  codebook dec;
+  oggpack_buffer ob;
+  unsigned char *buf;
+  long *used=malloc(s->entries*sizeof(*used));
+  long i,bytes,nused=0,calls,iters=64;
+  int dim=vector?s->dim:1;
+  int n=(32+dim-1)/dim*dim;
+  float *out;
+  double t0,t,best=1e9;
+  long sum=0;
+  int round;
+  char name[64];
+
+  for(i=0;i<s->entries;i++)
+    if(s->lengthlist[i]>0)used[nused++]=i;
+
+  oggpack_writeinit(&ob);
+  for(i=0;i<BOOK_WORDS;i++){
+    noise();
+    vorbis_book_encode(enc,used[(bench_seed>>8)%nused],&ob);
+  }
+  bytes=oggpack_bytes(&ob);
+  buf=malloc(bytes);
+  memcpy(buf,oggpack_get_buffer(&ob),bytes);
+  oggpack_writeclear(&ob);
+
+  vorbis_book_init_decode(&dec,s,0);
+  calls=BOOK_WORDS*dim/n;
+  out=calloc(n,sizeof(*out));
+
+  for(round=0;round<5;round++){
+    t0=now();
+    for(i=0;i<iters;i++){
+      long k;
+      oggpack_readinit(&ob,buf,bytes);
+      if(vector)
+        for(k=0;k<calls;k++)vorbis_book_decodev_add(&dec,out,&ob,n);
+      else
+        for(k=0;k<calls;k++)sum+=vorbis_book_decode(&dec,&ob);
+    }
+    t=now()-t0;
+    if(t<best)best=t;
+  }
+
+  if(vector){
+    sprintf(name,"vorbis_book_decodev_add_dim%d",dim);
+    report(name,best*1e9/iters/calls,n);
+  }else{
+    report("vorbis_book_decode",best*1e9/iters/calls,0);
+  }
+  report_extra("entries",nused);
+  report_extra("bits_per_word",bytes*8./BOOK_WORDS);
+
+  vorbis_book_clear(&dec);
+  free(out);
+  free(buf);
+  free(used);
+}
+
+static void bench_codebook(void){
+  bench_encoder e;
+  codec_setup_info *ci;
+  int i,dim,best;
+
+  if(encoder_open(&e,2,44100,.4f))return;
+  ci=e.vi.codec_setup;
+
+  best=-1;
+  for(i=0;i<ci->books;i++)
+    if(ci->book_param[i]->maptype==0 &&
+       (best<0 || ci->book_param[i]->entries>ci->book_param[best]->entries))
+      best=i;
+  if(best>=0)bench_book(ci->fullbooks+best,ci->book_param[best],0);
+
+  for(dim=1;dim<=8;dim++){
+    best=-1;
+    for(i=0;i<ci->books;i++)
+      if(ci->book_param[i]->maptype!=0 && ci->book_param[i]->dim==dim &&
+         (best<0 || ci->book_param[i]->entries>ci->book_param[best]->entries))
+        best=i;
+    if(best>=0)bench_book(ci->fullbooks+best,ci->book_param[best],1);
+  }
+  encoder_close(&e);
+}
+
+/* the residue decode of each long block in the stream (each short
+   one if there are none), all submaps;
+   the packet is unpacked up to the residue once and the reader put
+   back before each call.  Named after the residue type of the first
+   submap, which for the usual stereo stream is res2 */
+static void bench_residue(void){
+  bench_stream *s=stream_get();
+  bench_decoder d;
+  vorbis_info_mapping0 *info;
+  void **memo;
+  int *nonzero,*zerobundle;
+  float **pcmbundle;
+  long p,i,n=0,calls=0,iters=16;
+  double t0,spent,best=1e9;
+  int round,type=0,W;
+  char name[64];
+
+  if(!s || decoder_open(&d,s))return;
+  W=decoder_blockflag(&d,s);
+  memo=malloc(d.vi.channels*sizeof(*memo));
+  nonzero=malloc(d.vi.channels*sizeof(*nonzero));
+  zerobundle=malloc(d.vi.channels*sizeof(*zerobundle));
+  pcmbundle=malloc(d.vi.channels*sizeof(*pcmbundle));
+
+  for(round=0;round<5;round++){
+    spent=0;
+    calls=0;
+    for(p=3;p<s->packets;p++){
+      oggpack_buffer opb;
+      info=decoder_floors(&d,s->packet+p,memo,nonzero);
+      if(!info || d.vb.W!=W)continue;
+      opb=d.vb.opb;
+      t0=now();
+      for(i=0;i<iters;i++){
+        d.vb.opb=opb;
+        decoder_residue(&d,info,nonzero,pcmbundle,zerobundle);
+      }
+      spent+=now()-t0;
+      calls+=iters;
+      n=d.vb.pcmend/2;
+      type=((codec_setup_info *)d.vi.codec_setup)->
+        residue_type[info->residuesubmap[0]];
+    }
+    if(spent<best)best=spent;
+  }
+
+  if(calls){
+    sprintf(name,"res%d_inverse_%ld",type,n);
+    report(name,best*1e9/calls,n*d.vi.channels);
+  }
+  free(memo);
+  free(nonzero);
+  free(zerobundle);
+  free(pcmbundle);
+  decoder_close(&d);
+}
+
+/* floor1 synthesis, rendering each channel's floor of each long block
+   (or short, as above) into its decoded residue; the residue is copied back in before each
+   call (which is included in the time, but small next to it) */
+static void bench_floor1_inverse(void){
+  bench_stream *s=stream_get();
+  bench_decoder d;
+  codec_setup_info *ci;
+  private_state *b;
+  vorbis_info_mapping0 *info;
+  void **memo;
+  int *nonzero,*zerobundle;
+  float **pcmbundle,*work;
+  long p,i,n=0,calls=0,iters=16;
+  double t0,spent,best=1e9;
+  int round,j,W;
+  char name[64];
+
+  if(!s || decoder_open(&d,s))return;
+  W=decoder_blockflag(&d,s);
+  ci=d.vi.codec_setup;
+  b=d.vd.backend_state;
+  memo=malloc(d.vi.channels*sizeof(*memo));
+  nonzero=malloc(d.vi.channels*sizeof(*nonzero));
+  zerobundle=malloc(d.vi.channels*sizeof(*zerobundle));
+  pcmbundle=malloc(d.vi.channels*sizeof(*pcmbundle));
+  work=malloc(ci->blocksizes[1]/2*sizeof(*work));
+
+  for(round=0;round<5;round++){
+    spent=0;
+    calls=0;
+    for(p=3;p<s->packets;p++){
+      info=decoder_floors(&d,s->packet+p,memo,nonzero);
+      if(!info || d.vb.W!=W)continue;
+      decoder_residue(&d,info,nonzero,pcmbundle,zerobundle);
+      n=d.vb.pcmend/2;
+      for(j=0;j<d.vi.channels;j++){
+        int floor=info->floorsubmap[info->chmuxlist[j]];
+        if(ci->floor_type[floor]!=1 || !memo[j])continue;
+        t0=now();
+        for(i=0;i<iters;i++){
+          memcpy(work,d.vb.pcm[j],n*sizeof(*work));
+          _floor_P[1]->inverse2(&d.vb,b->flr[floor],memo[j],work);
+        }
+        spent+=now()-t0;
+        calls+=iters;
+      }
+    }
+    if(spent<best)best=spent;
+  }
+
+  if(calls){
+    sprintf(name,"floor1_inverse2_%ld",n);
+    report(name,best*1e9/calls,n);
+  }else
+    fprintf(stderr,"bench: no floor1 in %s\n",stream_name());
+  free(memo);
+  free(nonzero);
+  free(zerobundle);
+  free(pcmbundle);
+  free(work);
+  decoder_close(&d);
+}
+
+/* the whole decoder over the stream, per packet and as a multiple of
+   real time */
+static void bench_decode(void){
+  bench_stream *s=stream_get();
+  double best=1e9,rate=0;
+  long frames=0;
+  int channels=0,round;
+
+  if(!s)return;
+  for(round=0;round<3;round++){
+    bench_decoder d;
+    float **pcm;
+    long p,got;
+    double t0,t;
+
+    if(decoder_open(&d,s))return;
+    frames=0;
+    t0=now();
+    for(p=3;p<s->packets;p++){
+      if(vorbis_synthesis(&d.vb,s->packet+p)==0)
+        vorbis_synthesis_blockin(&d.vd,&d.vb);
+      while((got=vorbis_synthesis_pcmout(&d.vd,&pcm))>0){
+        frames+=got;
+        vorbis_synthesis_read(&d.vd,got);
+      }
+    }
+    t=now()-t0;
+    if(t<best)best=t;
+    rate=d.vi.rate;
+    channels=d.vi.channels;
+    decoder_close(&d);
+  }
+
+  if(s->packets<=3 || !frames)return;
+  report("decode",best*1e9/(s->packets-3),
+         (double)frames*channels/(s->packets-3));
+  report_extra("realtime",frames/rate/best);
+}
+
+/* the whole encoder across the quality range, per packet and as a
+   multiple of real time; only the library calls are timed, not making
+   up the input */
+static void bench_encode(void){
+  static const float quality[]={-.1f,.2f,.5f,.8f,1.f};
+  int q,round;
+  char name[64];
+
+  for(q=0;q<(int)(sizeof(quality)/sizeof(*quality));q++){
+    double best=1e9;
+    long bytes=0,packets=0;
+    for(round=0;round<3;round++){
+      bench_encoder e;
+      ogg_packet op;
+      double t0,spent=0;
+
+      if(encoder_open(&e,2,44100,quality[q]))return;
+      bytes=0;
+      packets=0;
+      while(e.fed<44100*4){
+        encoder_feed(&e,1024);
+        t0=now();
+        while(vorbis_analysis_blockout(&e.vd,&e.vb)==1){
+          vorbis_analysis(&e.vb,NULL);
+          vorbis_bitrate_addblock(&e.vb);
+          while(vorbis_bitrate_flushpacket(&e.vd,&op)){
+            bytes+=op.bytes;
+            packets++;
+          }
+        }
+        spent+=now()-t0;
+      }
+      encoder_close(&e);
+      if(spent<best)best=spent;
+    }
+    sprintf(name,"encode_q%.1f",quality[q]);
+    report(name,best*1e9/packets,44100.*4*2/packets);
+    report_extra("realtime",4./best);
+    report_extra("kbps",bytes*8/4/1000);
+  }
+}
+
+static const struct {
+  const char *name;
+  void (*run)(void);
+} cases[]={
+  {"analysis_alloc",bench_analysis_alloc},
+  {"mdct",bench_mdct},
+  {"fft",bench_fft},
+  {"bitread",bench_bitread},
+  {"codebook",bench_codebook},
+  {"decouple",bench_decouple},
+  {"psy",bench_psy},
+  {"floor1",bench_floor1},
+  {"couple",bench_couple},
+  {"envelope",bench_envelope},
+  {"residue",bench_residue},
+  {"floor1_inverse",bench_floor1_inverse},
+  {"decode",bench_decode},
+  {"encode",bench_encode},
+};
+
+int main(int argc,char **argv){
+  int i,j;
+  int n=sizeof(cases)/sizeof(*cases);
+  int named=0;
+
+  for(j=1;j<argc;j++){
+    if(!strcmp(argv[j],"-j")){
+      json=1;
+      argv[j]=NULL;
+    }else if(!strcmp(argv[j],"-f") && j+1<argc){
+      argv[j]=NULL;
+      stream_file=argv[++j];
+      argv[j]=NULL;
+    }else
+      named++;
+  }
+
+  /* a misspelt case would otherwise just leave a hole in the results */
+  for(j=1;j<argc;j++){
+    if(!argv[j])continue;
+    for(i=0;i<n;i++)
+      if(!strcmp(argv[j],cases[i].name))break;
+    if(i==n){
+      fprintf(stderr,"bench: no case %s; the cases are:\n",argv[j]);
+      for(i=0;i<n;i++)
+        fprintf(stderr,"  %s\n",cases[i].name);
+      return 1;
+    }
+  }
+
+  report_begin(stream_name());
+  for(i=0;i<n;i++){
+    if(named){
+      for(j=1;j<argc;j++)
+        if(argv[j] && !strcmp(argv[j],cases[i].name))break;
+      if(j==argc)continue;
+    }
+    cases[i].run();
+  }
+  report_end();
+  stream_clear(&stream);
+  return 0;
+}
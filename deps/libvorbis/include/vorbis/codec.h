@@ -193,6 +193,8 @@ extern int      vorbis_analysis_headerout(vorbis_dsp_state *v,
 extern float  **vorbis_analysis_buffer(vorbis_dsp_state *v,int vals);
 extern int      vorbis_analysis_wrote(vorbis_dsp_state *v,int vals);
 extern int      vorbis_analysis_blockout(vorbis_dsp_state *v,vorbis_block *vb);
+extern int      vorbis_analysis_transform(vorbis_block *vb);
+extern int      vorbis_analysis_ampmax(vorbis_block *vb);
 extern int      vorbis_analysis(vorbis_block *vb,ogg_packet *op);
 
 extern int      vorbis_bitrate_addblock(vorbis_block *vb);
@@ -216,6 +218,8 @@ extern long     vorbis_packet_blocksize(vorbis_info *vi,ogg_packet *op);
 
 extern int      vorbis_synthesis_halfrate(vorbis_info *v,int flag);
 extern int      vorbis_synthesis_halfrate_p(vorbis_info *v);
+extern int      vorbis_synthesis_lowmem(vorbis_info *v,int flag);
+extern int      vorbis_synthesis_lowmem_p(vorbis_info *v);
 
 /* Vorbis ERRORS and return codes ***********************************/
 
@@ -26,6 +26,49 @@
 #include "os.h"
 #include "misc.h"
 
+/* The analysis of a block is done in three steps, split around the
+   one piece of state that is carried from block to block, the
+   psychoacoustic peak tracker:
+
+     vorbis_analysis_transform()  windows and transforms the block; it
+                                  only touches the block itself
+     vorbis_analysis_ampmax()     folds the block's peak into the
+                                  tracker; call it in block order
+     vorbis_analysis()            does the rest; again block-local
+
+   so several blocks of the same stream can be transformed and
+   analysed at once, as long as the middle step is serialized.
+   vorbis_analysis() runs the first two itself if they weren't. */
+
+int vorbis_analysis_transform(vorbis_block *vb){
+  vorbis_block_internal *vbi=vb->internal;
+  int ret;
+
+  if((ret=_mapping_P[0]->transform(vb)))
+    return(ret);
+  vbi->transformed=1;
+  return(0);
+}
+
+int vorbis_analysis_ampmax(vorbis_block *vb){
+  vorbis_info *vi=vb->vd->vi;
+  private_state *b=vb->vd->backend_state;
+  vorbis_look_psy_global *g=b->psy_g_look;
+  vorbis_block_internal *vbi=vb->internal;
+  float amp;
+  int i;
+
+  if(!vbi->transformed)return(OV_EINVAL);
+
+  /* the peak of the previous block, decayed over this one */
+  amp=_vp_ampmax_decay(g->ampmax,vb);
+  for(i=0;i<vi->channels;i++)
+    if(vbi->local_ampmax[i]>amp)amp=vbi->local_ampmax[i];
+
+  g->ampmax=vbi->ampmax=amp;
+  return(0);
+}
+
 /* decides between modes, dispatches to the appropriate mapping. */
 int vorbis_analysis(vorbis_block *vb, ogg_packet *op){
   int ret,i;
@@ -40,6 +83,13 @@ int vorbis_analysis(vorbis_block *vb, ogg_packet *op){
   for(i=0;i<PACKETBLOBS;i++)
     oggpack_reset(vbi->packetblob[i]);
 
+  if(!vbi->transformed){
+    if((ret=vorbis_analysis_transform(vb)))
+      return(ret);
+    vorbis_analysis_ampmax(vb);
+  }
+  vbi->transformed=0;
+
   /* we only have one mapping type (0), and we let the mapping code
      itself figure out what soft mode to use.  This allows easier
      bitrate management */
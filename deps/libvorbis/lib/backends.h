@@ -124,6 +124,7 @@ typedef struct{
                                  oggpack_buffer *);
   vorbis_info_mapping *(*unpack)(vorbis_info *,oggpack_buffer *);
   void (*free_info)    (vorbis_info_mapping *);
+  int  (*transform)    (struct vorbis_block *vb);
   int  (*forward)      (struct vorbis_block *vb);
   int  (*inverse)      (struct vorbis_block *vb,vorbis_info_mapping *);
 } vorbis_func_mapping;
@@ -0,0 +1,54 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2009             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: inline oggpack_look()/oggpack_adv() for the decode hot path
+
+ These work on a plain oggpack_buffer and leave it exactly as libogg's
+ own calls would, so they can be freely mixed with oggpack_read() and
+ friends.  While eight or more bytes remain, a look of up to 32 bits is
+ a single 64 bit load and shift; near the end of the packet, and after
+ an overrun, they hand over to libogg for its bounds handling.
+
+ ********************************************************************/
+
+#ifndef _V_BITREAD_H_
+#define _V_BITREAD_H_
+
+#include <ogg/ogg.h>
+#include "os.h"
+
+STIN long _oggpack_look(oggpack_buffer *b,int bits){
+  if(b->endbyte+8<=b->storage){
+    const unsigned char *p=b->ptr;
+    /* compilers turn this into one unaligned load on little endian */
+    unsigned long long w=
+      (unsigned long long)p[0]     | (unsigned long long)p[1]<<8  |
+      (unsigned long long)p[2]<<16 | (unsigned long long)p[3]<<24 |
+      (unsigned long long)p[4]<<32 | (unsigned long long)p[5]<<40 |
+      (unsigned long long)p[6]<<48 | (unsigned long long)p[7]<<56;
+    return((long)((w>>b->endbit)&((1ULL<<bits)-1)));
+  }
+  return(oggpack_look(b,bits));
+}
+
+STIN void _oggpack_adv(oggpack_buffer *b,int bits){
+  if(b->endbyte+8<=b->storage){
+    bits+=b->endbit;
+    b->ptr+=bits>>3;
+    b->endbyte+=bits>>3;
+    b->endbit=bits&7;
+    return;
+  }
+  oggpack_adv(b,bits);
+}
+
+#endif
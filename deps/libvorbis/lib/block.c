@@ -30,6 +30,7 @@
 #include "lpc.h"
 #include "registry.h"
 #include "misc.h"
+#include "simd.h"
 
 static int ilog2(unsigned int v){
   int ret=0;
@@ -81,9 +82,31 @@ static int ilog2(unsigned int v){
 
 /* block abstraction setup *********************************************/
 
+/* extra room, in long blocks, left at the tail of the analysis PCM
+   buffer so the window can slide forward several blocks between
+   compactions */
+#define PCM_SLIDE_BLOCKS 4
+
 #ifndef WORD_ALIGN
+#ifdef VORBIS_SIMD
+#define WORD_ALIGN 16 /* keep block-local vectors vector aligned */
+#else
 #define WORD_ALIGN 8
 #endif
+#endif
+
+/* pcm=pcm*reversed window + p*window, the overlap/add of
+   vorbis_synthesis_blockin() */
+STIN void overlap_add(float *pcm,const float *p,const float *w,int n){
+  int i=0;
+#ifdef VORBIS_SIMD
+  for(;i+4<=n;i+=4)
+    v4_store(pcm+i,v4_add(v4_mul(v4_load(pcm+i),v4_reverse(v4_load(w+n-i-4))),
+                          v4_mul(v4_load(p+i),v4_load(w+i))));
+#endif
+  for(;i<n;i++)
+    pcm[i]=pcm[i]*w[n-i-1] + p[i]*w[i];
+}
 
 int vorbis_block_init(vorbis_dsp_state *v, vorbis_block *vb){
   int i;
@@ -105,6 +128,46 @@ int vorbis_block_init(vorbis_dsp_state *v, vorbis_block *vb){
       }
       oggpack_writeinit(vbi->packetblob[i]);
     }
+
+    /* analysis working storage, sized for the long block */
+    {
+      vorbis_info *vi=v->vi;
+      codec_setup_info *ci=vi->codec_setup;
+      int ch=vi->channels;
+      long n=ci->blocksizes[1]/2;
+      int k;
+
+      vbi->pcmdelay=_ogg_malloc(ch*sizeof(*vbi->pcmdelay));
+      vbi->pcmdelay[0]=_ogg_calloc(ch*n*2,sizeof(**vbi->pcmdelay));
+      vbi->gmdct=_ogg_malloc(ch*sizeof(*vbi->gmdct));
+      vbi->iwork=_ogg_malloc(ch*sizeof(*vbi->iwork));
+      vbi->floor_posts=_ogg_malloc(ch*sizeof(*vbi->floor_posts));
+      vbi->partword=_ogg_malloc(ch*sizeof(*vbi->partword));
+      vbi->gmdct[0]=_ogg_calloc(ch*n,sizeof(**vbi->gmdct));
+      vbi->iwork[0]=_ogg_calloc(ch*n,sizeof(**vbi->iwork));
+      vbi->floor_posts[0]=_ogg_malloc(ch*PACKETBLOBS*
+                                      sizeof(**vbi->floor_posts));
+      vbi->floor_store=_ogg_malloc(ch*PACKETBLOBS*(VIF_POSIT+2)*
+                                   sizeof(*vbi->floor_store));
+      for(i=1;i<ch;i++){
+        vbi->pcmdelay[i]=vbi->pcmdelay[0]+i*n*2;
+        vbi->gmdct[i]=vbi->gmdct[0]+i*n;
+        vbi->iwork[i]=vbi->iwork[0]+i*n;
+        vbi->floor_posts[i]=vbi->floor_posts[0]+i*PACKETBLOBS;
+      }
+      for(i=0;i<ch;i++)
+        for(k=0;k<PACKETBLOBS;k++)
+          vbi->floor_posts[i][k]=NULL;
+
+      vbi->noise=_ogg_calloc(n,sizeof(*vbi->noise));
+      vbi->tone=_ogg_calloc(n,sizeof(*vbi->tone));
+      vbi->local_ampmax=_ogg_calloc(ch,sizeof(*vbi->local_ampmax));
+      vbi->nonzero=_ogg_calloc(ch,sizeof(*vbi->nonzero));
+      vbi->couple_bundle=_ogg_calloc(ch,sizeof(*vbi->couple_bundle));
+      vbi->zerobundle=_ogg_calloc(ch,sizeof(*vbi->zerobundle));
+      vbi->partword_store=_ogg_calloc(ch*n,sizeof(*vbi->partword_store));
+      vbi->reswork=_ogg_calloc(ch*n,sizeof(*vbi->reswork));
+    }
   }
 
   return(0);
@@ -168,6 +231,32 @@ int vorbis_block_clear(vorbis_block *vb){
       oggpack_writeclear(vbi->packetblob[i]);
       if(i!=PACKETBLOBS/2)_ogg_free(vbi->packetblob[i]);
     }
+    if(vbi->pcmdelay){
+      _ogg_free(vbi->pcmdelay[0]);
+      _ogg_free(vbi->pcmdelay);
+    }
+    if(vbi->gmdct){
+      _ogg_free(vbi->gmdct[0]);
+      _ogg_free(vbi->gmdct);
+    }
+    if(vbi->iwork){
+      _ogg_free(vbi->iwork[0]);
+      _ogg_free(vbi->iwork);
+    }
+    if(vbi->floor_posts){
+      _ogg_free(vbi->floor_posts[0]);
+      _ogg_free(vbi->floor_posts);
+    }
+    if(vbi->floor_store)_ogg_free(vbi->floor_store);
+    if(vbi->noise)_ogg_free(vbi->noise);
+    if(vbi->tone)_ogg_free(vbi->tone);
+    if(vbi->local_ampmax)_ogg_free(vbi->local_ampmax);
+    if(vbi->nonzero)_ogg_free(vbi->nonzero);
+    if(vbi->couple_bundle)_ogg_free(vbi->couple_bundle);
+    if(vbi->zerobundle)_ogg_free(vbi->zerobundle);
+    if(vbi->partword)_ogg_free(vbi->partword);
+    if(vbi->partword_store)_ogg_free(vbi->partword_store);
+    if(vbi->reswork)_ogg_free(vbi->reswork);
     _ogg_free(vbi);
   }
   memset(vb,0,sizeof(*vb));
@@ -202,6 +291,10 @@ static int _vds_shared_init(vorbis_dsp_state *v,vorbis_info *vi,int encp){
   b->transform[1][0]=_ogg_calloc(1,sizeof(mdct_lookup));
   mdct_init(b->transform[0][0],ci->blocksizes[0]>>hs);
   mdct_init(b->transform[1][0],ci->blocksizes[1]>>hs);
+  if(!encp && ci->lowmem_flag){
+    mdct_lowmem(b->transform[0][0]);
+    mdct_lowmem(b->transform[1][0]);
+  }
 
   /* Vorbis I uses only window type 0 */
   b->window[0]=ilog2(ci->blocksizes[0])-6;
@@ -237,7 +330,8 @@ static int _vds_shared_init(vorbis_dsp_state *v,vorbis_info *vi,int encp){
       for(i=0;i<ci->books;i++){
         if(ci->book_param[i]==NULL)
           goto abort_books;
-        if(vorbis_book_init_decode(ci->fullbooks+i,ci->book_param[i]))
+        if(vorbis_book_init_decode(ci->fullbooks+i,ci->book_param[i],
+                                   ci->lowmem_flag))
           goto abort_books;
         /* decode codebooks are now standalone after init */
         vorbis_staticbook_destroy(ci->book_param[i]);
@@ -367,9 +461,10 @@ void vorbis_dsp_clear(vorbis_dsp_state *v){
     }
 
     if(v->pcm){
+      long offset=(b?b->pcm_offset:0);
       if(vi)
         for(i=0;i<vi->channels;i++)
-          if(v->pcm[i])_ogg_free(v->pcm[i]);
+          if(v->pcm[i])_ogg_free(v->pcm[i]-offset);
       _ogg_free(v->pcm);
       if(v->pcmret)_ogg_free(v->pcmret);
     }
@@ -397,10 +492,22 @@ float **vorbis_analysis_buffer(vorbis_dsp_state *v, int vals){
   if(b->header2)_ogg_free(b->header2);b->header2=NULL;
 
   /* Do we have enough storage space for the requested buffer? If not,
-     expand the PCM (and envelope) storage */
+     first slide the window back to the start of its allocation, and
+     only if that is still not enough expand the PCM storage */
+
+  if(v->pcm_current+vals>=v->pcm_storage && b->pcm_offset){
+    for(i=0;i<vi->channels;i++){
+      float *base=v->pcm[i]-b->pcm_offset;
+      memmove(base,v->pcm[i],v->pcm_current*sizeof(*v->pcm[i]));
+      v->pcm[i]=base;
+    }
+    v->pcm_storage+=b->pcm_offset;
+    b->pcm_offset=0;
+  }
 
   if(v->pcm_current+vals>=v->pcm_storage){
-    v->pcm_storage=v->pcm_current+vals*2;
+    codec_setup_info *ci=vi->codec_setup;
+    v->pcm_storage=v->pcm_current+vals*2+ci->blocksizes[1]*PCM_SLIDE_BLOCKS;
 
     for(i=0;i<vi->channels;i++){
       v->pcm[i]=_ogg_realloc(v->pcm[i],v->pcm_storage*sizeof(*v->pcm[i]));
@@ -526,7 +633,6 @@ int vorbis_analysis_blockout(vorbis_dsp_state *v,vorbis_block *vb){
   vorbis_info *vi=v->vi;
   codec_setup_info *ci=vi->codec_setup;
   private_state *b=v->backend_state;
-  vorbis_look_psy_global *g=b->psy_g_look;
   long beginW=v->centerW-ci->blocksizes[v->W]/2,centerNext;
   vorbis_block_internal *vbi=(vorbis_block_internal *)vb->internal;
 
@@ -608,29 +714,18 @@ int vorbis_analysis_blockout(vorbis_dsp_state *v,vorbis_block *vb){
   vb->sequence=v->sequence++;
   vb->granulepos=v->granulepos;
   vb->pcmend=ci->blocksizes[v->W];
+  vbi->transformed=0;
 
   /* copy the vectors; this uses the local storage in vb */
 
-  /* this tracks 'strongest peak' for later psychoacoustics */
-  /* moved to the global psy state; clean this mess up */
-  if(vbi->ampmax>g->ampmax)g->ampmax=vbi->ampmax;
-  g->ampmax=_vp_ampmax_decay(g->ampmax,v);
-  vbi->ampmax=g->ampmax;
-
-  vb->pcm=_vorbis_block_alloc(vb,sizeof(*vb->pcm)*vi->channels);
-  vbi->pcmdelay=_vorbis_block_alloc(vb,sizeof(*vbi->pcmdelay)*vi->channels);
-  for(i=0;i<vi->channels;i++){
-    vbi->pcmdelay[i]=
-      _vorbis_block_alloc(vb,(vb->pcmend+beginW)*sizeof(*vbi->pcmdelay[i]));
-    memcpy(vbi->pcmdelay[i],v->pcm[i],(vb->pcmend+beginW)*sizeof(*vbi->pcmdelay[i]));
-    vb->pcm[i]=vbi->pcmdelay[i]+beginW;
-
-    /* before we added the delay
-       vb->pcm[i]=_vorbis_block_alloc(vb,vb->pcmend*sizeof(*vb->pcm[i]));
-       memcpy(vb->pcm[i],v->pcm[i]+beginW,ci->blocksizes[v->W]*sizeof(*vb->pcm[i]));
-    */
+  /* the 'strongest peak' tracking for later psychoacoustics is done
+     by vorbis_analysis_ampmax(), once the block's spectrum is known */
 
-  }
+  /* the block is windowed and transformed in place, so it gets its
+     own copy; nothing reads the samples ahead of beginW */
+  vb->pcm=vbi->pcmdelay;
+  for(i=0;i<vi->channels;i++)
+    memcpy(vb->pcm[i],v->pcm[i]+beginW,vb->pcmend*sizeof(*vb->pcm[i]));
 
   /* handle eof detection: eof==0 means that we've not yet received EOF
                            eof>0  marks the last 'real' sample in pcm[]
@@ -654,9 +749,12 @@ int vorbis_analysis_blockout(vorbis_dsp_state *v,vorbis_block *vb){
       _ve_envelope_shift(b->ve,movementW);
       v->pcm_current-=movementW;
 
+      /* slide the window rather than moving the samples; storage is
+         compacted lazily by vorbis_analysis_buffer() */
       for(i=0;i<vi->channels;i++)
-        memmove(v->pcm[i],v->pcm[i]+movementW,
-                v->pcm_current*sizeof(*v->pcm[i]));
+        v->pcm[i]+=movementW;
+      v->pcm_storage-=movementW;
+      b->pcm_offset+=movementW;
 
 
       v->lW=v->W;
@@ -774,15 +872,13 @@ int vorbis_synthesis_blockin(vorbis_dsp_state *v,vorbis_block *vb){
           float *w=_vorbis_window_get(b->window[1]-hs);
           float *pcm=v->pcm[j]+prevCenter;
           float *p=vb->pcm[j];
-          for(i=0;i<n1;i++)
-            pcm[i]=pcm[i]*w[n1-i-1] + p[i]*w[i];
+          overlap_add(pcm,p,w,n1);
         }else{
           /* large/small */
           float *w=_vorbis_window_get(b->window[0]-hs);
           float *pcm=v->pcm[j]+prevCenter+n1/2-n0/2;
           float *p=vb->pcm[j];
-          for(i=0;i<n0;i++)
-            pcm[i]=pcm[i]*w[n0-i-1] +p[i]*w[i];
+          overlap_add(pcm,p,w,n0);
         }
       }else{
         if(v->W){
@@ -790,17 +886,15 @@ int vorbis_synthesis_blockin(vorbis_dsp_state *v,vorbis_block *vb){
           float *w=_vorbis_window_get(b->window[0]-hs);
           float *pcm=v->pcm[j]+prevCenter;
           float *p=vb->pcm[j]+n1/2-n0/2;
-          for(i=0;i<n0;i++)
-            pcm[i]=pcm[i]*w[n0-i-1] +p[i]*w[i];
-          for(;i<n1/2+n0/2;i++)
+          overlap_add(pcm,p,w,n0);
+          for(i=n0;i<n1/2+n0/2;i++)
             pcm[i]=p[i];
         }else{
           /* small/small */
           float *w=_vorbis_window_get(b->window[0]-hs);
           float *pcm=v->pcm[j]+prevCenter;
           float *p=vb->pcm[j];
-          for(i=0;i<n0;i++)
-            pcm[i]=pcm[i]*w[n0-i-1] +p[i]*w[i];
+          overlap_add(pcm,p,w,n0);
         }
       }
 
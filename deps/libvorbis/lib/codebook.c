@@ -24,6 +24,7 @@
 #include "scales.h"
 #include "misc.h"
 #include "os.h"
+#include "bitread.h"
 
 /* packs the given codebook into the bitstream **************************/
 
@@ -296,7 +297,7 @@ static ogg_uint32_t bitreverse(ogg_uint32_t x){
 STIN long decode_packed_entry_number(codebook *book, oggpack_buffer *b){
   int  read=book->dec_maxlength;
   long lo,hi;
-  long lok = oggpack_look(b,book->dec_firsttablen);
+  long lok = _oggpack_look(b,book->dec_firsttablen);
 
   if (lok >= 0) {
     long entry = book->dec_firsttable[lok];
@@ -304,7 +305,7 @@ STIN long decode_packed_entry_number(codebook *book, oggpack_buffer *b){
       lo=(entry>>15)&0x7fff;
       hi=book->used_entries-(entry&0x7fff);
     }else{
-      oggpack_adv(b, book->dec_codelengths[entry-1]);
+      _oggpack_adv(b, book->dec_codelengths[entry-1]);
       return(entry-1);
     }
   }else{
@@ -312,10 +313,10 @@ STIN long decode_packed_entry_number(codebook *book, oggpack_buffer *b){
     hi=book->used_entries;
   }
 
-  lok = oggpack_look(b, read);
+  lok = _oggpack_look(b, read);
 
   while(lok<0 && read>1)
-    lok = oggpack_look(b, --read);
+    lok = _oggpack_look(b, --read);
   if(lok<0)return -1;
 
   /* bisect search for the codeword in the ordered list */
@@ -330,16 +331,56 @@ STIN long decode_packed_entry_number(codebook *book, oggpack_buffer *b){
       }
 
     if(book->dec_codelengths[lo]<=read){
-      oggpack_adv(b, book->dec_codelengths[lo]);
+      _oggpack_adv(b, book->dec_codelengths[lo]);
       return(lo);
     }
   }
 
-  oggpack_adv(b, read);
+  _oggpack_adv(b, read);
 
   return(-1);
 }
 
+/* decodes up to max (at most DEC_MULTI) consecutive packed entries into
+   entry[]; returns how many, or -1 on eof.  Never reads past the max'th
+   codeword, as the next one may belong to another book */
+STIN int decode_packed_entries(codebook *book, oggpack_buffer *b,
+                               long *entry, int max){
+  if(book->dec_multitable){
+    long lok = _oggpack_look(b, book->dec_multitablen);
+
+    if(lok >= 0){
+      const dec_multi *m = book->dec_multitable+lok;
+      int i,count = m->count;
+
+      if(count>0){
+        if(count>max)count=max;
+        for(i=0;i<count;i++)
+          entry[i]=m->entry[i];
+        _oggpack_adv(b, m->bits[count-1]);
+        return(count);
+      }
+    }
+  }
+
+  entry[0]=decode_packed_entry_number(book,b);
+  return(entry[0]<0?-1:1);
+}
+
+/* the values of packed entry `entry`: in valuelist, or for a low-memory
+   lattice book, looked up into tmp (dim floats) */
+STIN const float *entry_values(codebook *book,long entry,int dim,
+                               float *tmp){
+  if(book->dec_lattice){
+    const unsigned char *p=book->dec_lattice+entry*dim;
+    int j;
+    for(j=0;j<dim;j++)
+      tmp[j]=book->dec_latticevals[p[j]];
+    return(tmp);
+  }
+  return(book->valuelist+entry*dim);
+}
+
 /* Decode side is specced and easier, because we don't need to find
    matches using different criteria; we simply read and map.  There are
    two things we need to do 'depending':
@@ -359,7 +400,8 @@ long vorbis_book_decode(codebook *book, oggpack_buffer *b){
   if(book->used_entries>0){
     long packed_entry=decode_packed_entry_number(book,b);
     if(packed_entry>=0)
-      return(book->dec_index[packed_entry]);
+      return(book->dec_index?book->dec_index[packed_entry]:
+             book->dec_index16[packed_entry]);
   }
 
   /* if there's no dec_index, the codebook unpacking isn't collapsed */
@@ -372,13 +414,17 @@ long vorbis_book_decodevs_add(codebook *book,float *a,oggpack_buffer *b,int n){
   if(book->used_entries>0){
     int step=n/book->dim;
     long *entry = alloca(sizeof(*entry)*step);
-    float **t = alloca(sizeof(*t)*step);
-    int i,j,o;
-
-    for (i = 0; i < step; i++) {
-      entry[i]=decode_packed_entry_number(book,b);
-      if(entry[i]==-1)return(-1);
-      t[i] = book->valuelist+entry[i]*book->dim;
+    const float **t = alloca(sizeof(*t)*step);
+    float *tmp =
+      book->dec_lattice ? alloca(sizeof(*tmp)*step*book->dim) : NULL;
+    int i,j,o,got;
+
+    for (i = 0; i < step;) {
+      got=decode_packed_entries(book,b,entry+i,
+                                step-i<DEC_MULTI?step-i:DEC_MULTI);
+      if(got==-1)return(-1);
+      for(;got>0;got--,i++)
+        t[i] = entry_values(book,entry[i],book->dim,tmp+i*book->dim);
     }
     for(i=0,o=0;i<book->dim;i++,o+=step)
       for (j=0;j<step;j++)
@@ -387,47 +433,40 @@ long vorbis_book_decodevs_add(codebook *book,float *a,oggpack_buffer *b,int n){
   return(0);
 }
 
+/* the body of vorbis_book_decodev_add(); inlined with a constant dim
+   for the common dimensions so the inner loop unrolls */
+STIN long decodev_add(codebook *book,float *a,oggpack_buffer *b,int n,
+                      const int dim,float *tmp){
+  long entry[DEC_MULTI];
+  int i,j,k,got;
+
+  for(i=0;i<n;){
+    got=decode_packed_entries(book,b,entry,(n-i+dim-1)/dim);
+    if(got==-1)return(-1);
+    for(k=0;k<got;k++){
+      const float *t = entry_values(book,entry[k],dim,tmp);
+      for (j=0;j<dim;j++)
+        a[i++]+=t[j];
+    }
+  }
+  return(0);
+}
+
 /* decode vector / dim granularity gaurding is done in the upper layer */
 long vorbis_book_decodev_add(codebook *book,float *a,oggpack_buffer *b,int n){
   if(book->used_entries>0){
-    int i,j,entry;
-    float *t;
-
-    if(book->dim>8){
-      for(i=0;i<n;){
-        entry = decode_packed_entry_number(book,b);
-        if(entry==-1)return(-1);
-        t     = book->valuelist+entry*book->dim;
-        for (j=0;j<book->dim;)
-          a[i++]+=t[j++];
-      }
-    }else{
-      for(i=0;i<n;){
-        entry = decode_packed_entry_number(book,b);
-        if(entry==-1)return(-1);
-        t     = book->valuelist+entry*book->dim;
-        j=0;
-        switch((int)book->dim){
-        case 8:
-          a[i++]+=t[j++];
-        case 7:
-          a[i++]+=t[j++];
-        case 6:
-          a[i++]+=t[j++];
-        case 5:
-          a[i++]+=t[j++];
-        case 4:
-          a[i++]+=t[j++];
-        case 3:
-          a[i++]+=t[j++];
-        case 2:
-          a[i++]+=t[j++];
-        case 1:
-          a[i++]+=t[j++];
-        case 0:
-          break;
-        }
-      }
+    float *tmp = book->dec_lattice ? alloca(sizeof(*tmp)*book->dim) : NULL;
+    switch((int)book->dim){
+    case 1:
+      return(decodev_add(book,a,b,n,1,tmp));
+    case 2:
+      return(decodev_add(book,a,b,n,2,tmp));
+    case 4:
+      return(decodev_add(book,a,b,n,4,tmp));
+    case 8:
+      return(decodev_add(book,a,b,n,8,tmp));
+    default:
+      return(decodev_add(book,a,b,n,book->dim,tmp));
     }
   }
   return(0);
@@ -439,12 +478,13 @@ long vorbis_book_decodev_add(codebook *book,float *a,oggpack_buffer *b,int n){
 long vorbis_book_decodev_set(codebook *book,float *a,oggpack_buffer *b,int n){
   if(book->used_entries>0){
     int i,j,entry;
-    float *t;
+    const float *t;
+    float *tmp = book->dec_lattice ? alloca(sizeof(*tmp)*book->dim) : NULL;
 
     for(i=0;i<n;){
       entry = decode_packed_entry_number(book,b);
       if(entry==-1)return(-1);
-      t     = book->valuelist+entry*book->dim;
+      t     = entry_values(book,entry,book->dim,tmp);
       for (j=0;i<n && j<book->dim;){
         a[i++]=t[j++];
       }
@@ -459,25 +499,83 @@ long vorbis_book_decodev_set(codebook *book,float *a,oggpack_buffer *b,int n){
   return(0);
 }
 
+/* as decodev_add(), for vorbis_book_decodevv_add() */
+STIN long decodevv_add(codebook *book,float **a,long offset,int ch,
+                       oggpack_buffer *b,int n,const int dim,
+                       float *tmp){
+  long entry[DEC_MULTI];
+  long i,j,k,got;
+  int chptr=0;
+
+  for(i=offset/ch;i<(offset+n)/ch;){
+    long left=((offset+n)/ch-i)*ch-chptr;
+    got=decode_packed_entries(book,b,entry,(left+dim-1)/dim);
+    if(got==-1)return(-1);
+    for(k=0;k<got;k++){
+      const float *t = entry_values(book,entry[k],dim,tmp);
+      for (j=0;j<dim;j++){
+        a[chptr++][i]+=t[j];
+        if(chptr==ch){
+          chptr=0;
+          i++;
+        }
+      }
+    }
+  }
+  return(0);
+}
+
+/* the stereo case with an even dim, where every entry covers whole
+   sample pairs: no channel stepping, just two vectors */
+STIN long decodevv2_add(codebook *book,float *a0,float *a1,long offset,
+                        oggpack_buffer *b,int n,const int dim,
+                       float *tmp){
+  long entry[DEC_MULTI];
+  long i,j,k,got;
+
+  for(i=offset/2;i<(offset+n)/2;){
+    got=decode_packed_entries(book,b,entry,(((offset+n)/2-i)*2+dim-1)/dim);
+    if(got==-1)return(-1);
+    for(k=0;k<got;k++){
+      const float *t = entry_values(book,entry[k],dim,tmp);
+      for (j=0;j<dim;j+=2,i++){
+        a0[i]+=t[j];
+        a1[i]+=t[j+1];
+      }
+    }
+  }
+  return(0);
+}
+
 long vorbis_book_decodevv_add(codebook *book,float **a,long offset,int ch,
                               oggpack_buffer *b,int n){
+  float *tmp = book->dec_lattice ? alloca(sizeof(*tmp)*book->dim) : NULL;
+
+  if(book->used_entries>0 && ch==2 && !(book->dim&1)){
+    switch((int)book->dim){
+    case 2:
+      return(decodevv2_add(book,a[0],a[1],offset,b,n,2,tmp));
+    case 4:
+      return(decodevv2_add(book,a[0],a[1],offset,b,n,4,tmp));
+    case 8:
+      return(decodevv2_add(book,a[0],a[1],offset,b,n,8,tmp));
+    default:
+      return(decodevv2_add(book,a[0],a[1],offset,b,n,book->dim,tmp));
+    }
+  }
 
-  long i,j,entry;
-  int chptr=0;
   if(book->used_entries>0){
-    for(i=offset/ch;i<(offset+n)/ch;){
-      entry = decode_packed_entry_number(book,b);
-      if(entry==-1)return(-1);
-      {
-        const float *t = book->valuelist+entry*book->dim;
-        for (j=0;j<book->dim;j++){
-          a[chptr++][i]+=t[j];
-          if(chptr==ch){
-            chptr=0;
-            i++;
-          }
-        }
-      }
+    switch((int)book->dim){
+    case 1:
+      return(decodevv_add(book,a,offset,ch,b,n,1,tmp));
+    case 2:
+      return(decodevv_add(book,a,offset,ch,b,n,2,tmp));
+    case 4:
+      return(decodevv_add(book,a,offset,ch,b,n,4,tmp));
+    case 8:
+      return(decodevv_add(book,a,offset,ch,b,n,8,tmp));
+    default:
+      return(decodevv_add(book,a,offset,ch,b,n,book->dim,tmp));
     }
   }
   return(0);
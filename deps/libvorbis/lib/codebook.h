@@ -55,6 +55,17 @@ typedef struct static_codebook{
   int allocedp;
 } static_codebook;
 
+/* several consecutive short codewords resolved by one lookup in the
+   decode side multi table */
+#define DEC_MULTI 3
+#define DEC_MULTITABLEN 8  /* bits of lookahead, at most */
+
+typedef struct dec_multi{
+  unsigned char count;            /* codewords resolved, 0...DEC_MULTI */
+  unsigned char bits[DEC_MULTI];  /* total length of the first 1...count */
+  ogg_uint16_t  entry[DEC_MULTI]; /* their packed entry numbers */
+} dec_multi;
+
 typedef struct codebook{
   long dim;           /* codebook dimensions (elements per vector) */
   long entries;       /* codebook entries */
@@ -68,23 +79,41 @@ typedef struct codebook{
   ogg_uint32_t *codelist;   /* list of bitstream codewords for each entry */
 
   int          *dec_index;  /* only used if sparseness collapsed */
+  ogg_uint16_t *dec_index16; /* the same, in low-memory mode, when every
+                                entry number fits */
+  unsigned char *dec_lattice; /* low-memory mode, for lattice (maptype 1)
+                                 books: the lattice point of each scalar,
+                                 in place of valuelist */
+  float        *dec_latticevals; /* and the value of each lattice point */
   char         *dec_codelengths;
   ogg_uint32_t *dec_firsttable;
   int           dec_firsttablen;
   int           dec_maxlength;
+  dec_multi    *dec_multitable; /* NULL if no two codewords fit a lookup */
+  int           dec_multitablen;
 
   /* The current encoder uses only centered, integer-only lattice books. */
   int           quantvals;
   int           minval;
   int           delta;
+
+  /* encode only: the lattice digit and the lattice value each scalar
+     from enc_latticemin on quantizes to, so that res0.c can look them
+     up rather than divide by the delta */
+  int          *enc_lattice;     /* enc_latticelen digit, value pairs */
+  int           enc_latticemin;
+  int           enc_latticelen;
 } codebook;
 
 extern void vorbis_staticbook_destroy(static_codebook *b);
 extern int vorbis_book_init_encode(codebook *dest,const static_codebook *source);
-extern int vorbis_book_init_decode(codebook *dest,const static_codebook *source);
+extern int vorbis_book_init_decode(codebook *dest,const static_codebook *source,
+                                   int lowmem);
 extern void vorbis_book_clear(codebook *b);
 
 extern float *_book_unquantize(const static_codebook *b,int n,int *map);
+extern unsigned char *_book_lattice(const static_codebook *b,int n,int *map,
+                                    float **vals);
 extern float *_book_logdist(const static_codebook *b,float *vals);
 extern float _float32_unpack(long val);
 extern long   _float32_pack(float val);
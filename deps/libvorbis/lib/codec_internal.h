@@ -29,14 +29,32 @@
 #define PACKETBLOBS 15
 
 typedef struct vorbis_block_internal{
-  float  **pcmdelay;  /* this is a pointer into local storage */
+  float  **pcmdelay;  /* [ch][blocksizes[1]]; copy of the block's pcm */
   float  ampmax;
   int    blocktype;
+  int    transformed; /* vorbis_analysis_transform() has been run */
 
   oggpack_buffer *packetblob[PACKETBLOBS]; /* initialized, must be freed;
                                               blob [PACKETBLOBS/2] points to
                                               the oggpack_buffer in the
                                               main vorbis_block */
+
+  /* analysis working storage.  Sized for the long blocksize by
+     vorbis_block_init() and reused for every block, so the forward
+     mapping/floor/residue path never touches the block arena */
+  float  **gmdct;        /* [ch][blocksizes[1]/2] */
+  int    **iwork;        /* [ch][blocksizes[1]/2] */
+  int   ***floor_posts;  /* [ch][PACKETBLOBS] -> floor_store */
+  int     *floor_store;  /* ch*PACKETBLOBS*(VIF_POSIT+2) */
+  float   *noise;        /* [blocksizes[1]/2] */
+  float   *tone;         /* [blocksizes[1]/2] */
+  float   *local_ampmax; /* [ch] */
+  int     *nonzero;      /* [ch] */
+  int    **couple_bundle;/* [ch] */
+  int     *zerobundle;   /* [ch] */
+  long   **partword;     /* [ch]; residue classification */
+  long    *partword_store; /* ch*blocksizes[1]/2 */
+  int     *reswork;      /* ch*blocksizes[1]/2; res2 interleave */
 } vorbis_block_internal;
 
 typedef void vorbis_look_floor;
@@ -82,6 +100,12 @@ typedef struct private_state {
   bitrate_manager_state bms;
 
   ogg_int64_t sample_count;
+
+  /* encode side: v->pcm[i] is a window that slides forward through
+     its allocation as blocks are consumed; this is how far it has
+     slid.  The window is only moved back to the start of the
+     allocation when the tail runs out of room */
+  long pcm_offset;
 } private_state;
 
 /* codec_setup_info contains all the setup information specific to the
@@ -128,6 +152,7 @@ typedef struct codec_setup_info {
                                 highly redundant structure, but
                                 improves clarity of program flow. */
   int         halfrate_flag; /* painless downsample for decode */
+  int         lowmem_flag;   /* smallest decode tables, at some speed */
 } codec_setup_info;
 
 extern vorbis_look_psy_global *_vp_global_look(vorbis_info *vi);
@@ -157,11 +182,15 @@ typedef struct {
 
 extern int *floor1_fit(vorbis_block *vb,vorbis_look_floor1 *look,
                           const float *logmdct,   /* in */
-                          const float *logmask);
+                          const float *logmask,
+                          int *output);           /* VIF_POSIT+2 */
 extern int *floor1_interpolate_fit(vorbis_block *vb,vorbis_look_floor1 *look,
                           int *A,int *B,
-                          int del);
+                          int del,
+                          int *output);           /* VIF_POSIT+2 */
 extern int floor1_encode(oggpack_buffer *opb,vorbis_block *vb,
                   vorbis_look_floor1 *look,
                   int *post,int *ilogmask);
+
+extern void mapping0_decouple(float *mag,float *ang,long n);
 #endif
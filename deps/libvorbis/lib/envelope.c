@@ -28,6 +28,7 @@
 #include "envelope.h"
 #include "mdct.h"
 #include "misc.h"
+#include "simd.h"
 
 void _ve_envelope_init(envelope_lookup *e,vorbis_info *vi){
   codec_setup_info *ci=vi->codec_setup;
@@ -115,8 +116,13 @@ static int _ve_amp(envelope_lookup *ve,
     totalshift+pos*ve->searchstep);*/
 
  /* window and transform */
+#ifdef VORBIS_SIMD
+  for(i=0;i<n;i+=4)
+    v4_store(vec+i,v4_mul(v4_load(data+i),v4_load(ve->mdct_win+i)));
+#else
   for(i=0;i<n;i++)
     vec[i]=data[i]*ve->mdct_win[i];
+#endif
   mdct_forward(&ve->mdct,vec,vec);
 
   /*_analysis_output_always("mdct",seq2,vec,n/2,0,1,0); */
@@ -148,6 +154,33 @@ static int _ve_amp(envelope_lookup *ve,
   /* perform spreading and limiting, also smooth the spectrum.  yes,
      the MDCT results in all real coefficients, but it still *behaves*
      like real/imaginary pairs */
+#ifdef VORBIS_SIMD
+  {
+    /* the decaying limit is a serial chain, rounded at every step, so
+       lay it out first; then four pairs at a time, with todB() spelled
+       out on the vector */
+    float *limit=alloca(n/4*sizeof(*limit));
+    for(i=0;i<n/4;i++){
+      limit[i]=decay;
+      decay-=8.;
+    }
+    for(i=0;i<n/2;i+=8){
+      v4sf a=v4_load(vec+i);
+      v4sf b=v4_load(vec+i+4);
+      v4sf re=v4_even(a,b);
+      v4sf im=v4_odd(a,b);
+      v4sf val=v4_add(v4_mul(re,re),v4_mul(im,im));
+      v4sf lim=v4_load(limit+(i>>1));
+      v4sf minv=v4_set1(minV);
+      val=v4_sub(v4_mul(v4_bitsf(v4_abs(val)),v4_set1(7.17711438e-7f)),
+                 v4_set1(764.6161886f));
+      val=v4_mul(val,v4_set1(.5f));
+      val=v4_select(v4_cmpgt(lim,val),lim,val);
+      val=v4_select(v4_cmpgt(minv,val),minv,val);
+      v4_store(vec+(i>>1),val);
+    }
+  }
+#else
   for(i=0;i<n/2;i+=2){
     float val=vec[i]*vec[i]+vec[i+1]*vec[i+1];
     val=todB(&val)*.5f;
@@ -156,6 +189,7 @@ static int _ve_amp(envelope_lookup *ve,
     vec[i>>1]=val;
     decay-=8.;
   }
+#endif
 
   /*_analysis_output_always("spread",seq2++,vec,n/4,0,0,0);*/
 
@@ -107,40 +107,40 @@ static vorbis_info_floor *floor0_unpack (vorbis_info *vi,oggpack_buffer *opb){
 
    The below is authoritative in terms of defining scale mapping.
    Note that the scale depends on the sampling rate as well as the
-   linear block and mapping sizes */
-
-static void floor0_map_lazy_init(vorbis_block      *vb,
-                                 vorbis_info_floor *infoX,
-                                 vorbis_look_floor0 *look){
-  if(!look->linearmap[vb->W]){
-    vorbis_dsp_state   *vd=vb->vd;
-    vorbis_info        *vi=vd->vi;
-    codec_setup_info   *ci=vi->codec_setup;
-    vorbis_info_floor0 *info=(vorbis_info_floor0 *)infoX;
-    int W=vb->W;
-    int n=ci->blocksizes[W]/2,j;
-
-    /* we choose a scaling constant so that:
-       floor(bark(rate/2-1)*C)=mapped-1
+   linear block and mapping sizes.
+
+   Both blocksizes are set up front by floor0_look() rather than on
+   first use, so that the look is read-only during decode and several
+   blocks may be decoded at once */
+
+static void floor0_map_init(vorbis_dsp_state   *vd,
+                            vorbis_info_floor0 *info,
+                            vorbis_look_floor0 *look,
+                            int W){
+  vorbis_info        *vi=vd->vi;
+  codec_setup_info   *ci=vi->codec_setup;
+  int n=ci->blocksizes[W]/2,j;
+
+  /* we choose a scaling constant so that:
+     floor(bark(rate/2-1)*C)=mapped-1
      floor(bark(rate/2)*C)=mapped */
-    float scale=look->ln/toBARK(info->rate/2.f);
-
-    /* the mapping from a linear scale to a smaller bark scale is
-       straightforward.  We do *not* make sure that the linear mapping
-       does not skip bark-scale bins; the decoder simply skips them and
-       the encoder may do what it wishes in filling them.  They're
-       necessary in some mapping combinations to keep the scale spacing
-       accurate */
-    look->linearmap[W]=_ogg_malloc((n+1)*sizeof(**look->linearmap));
-    for(j=0;j<n;j++){
-      int val=floor( toBARK((info->rate/2.f)/n*j)
-                     *scale); /* bark numbers represent band edges */
-      if(val>=look->ln)val=look->ln-1; /* guard against the approximation */
-      look->linearmap[W][j]=val;
-    }
-    look->linearmap[W][j]=-1;
-    look->n[W]=n;
+  float scale=look->ln/toBARK(info->rate/2.f);
+
+  /* the mapping from a linear scale to a smaller bark scale is
+     straightforward.  We do *not* make sure that the linear mapping
+     does not skip bark-scale bins; the decoder simply skips them and
+     the encoder may do what it wishes in filling them.  They're
+     necessary in some mapping combinations to keep the scale spacing
+     accurate */
+  look->linearmap[W]=_ogg_malloc((n+1)*sizeof(**look->linearmap));
+  for(j=0;j<n;j++){
+    int val=floor( toBARK((info->rate/2.f)/n*j)
+                   *scale); /* bark numbers represent band edges */
+    if(val>=look->ln)val=look->ln-1; /* guard against the approximation */
+    look->linearmap[W][j]=val;
   }
+  look->linearmap[W][j]=-1;
+  look->n[W]=n;
 }
 
 static vorbis_look_floor *floor0_look(vorbis_dsp_state *vd,
@@ -152,6 +152,8 @@ static vorbis_look_floor *floor0_look(vorbis_dsp_state *vd,
   look->vi=info;
 
   look->linearmap=_ogg_calloc(2,sizeof(*look->linearmap));
+  floor0_map_init(vd,info,look,0);
+  floor0_map_init(vd,info,look,1);
 
   return look;
 }
@@ -196,8 +198,6 @@ static int floor0_inverse2(vorbis_block *vb,vorbis_look_floor *i,
   vorbis_look_floor0 *look=(vorbis_look_floor0 *)i;
   vorbis_info_floor0 *info=look->vi;
 
-  floor0_map_lazy_init(vb,info,look);
-
   if(memo){
     float *lsp=(float *)memo;
     float amp=lsp[look->m];
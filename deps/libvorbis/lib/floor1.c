@@ -47,6 +47,14 @@ typedef struct lsfit_acc{
   int y2b;
   int xyb;
   int bn;
+
+  /* both sets combined with this range's weight, which fit_line()
+     would otherwise work out again for every span it is part of */
+  double wx;
+  double wy;
+  double wx2;
+  double wxy;
+  double wn;
 } lsfit_acc;
 
 /***********************************************/
@@ -418,8 +426,12 @@ static void render_line0(int n, int x0,int x1,int y0,int y1,int *d){
   }
 }
 
-/* the floor has already been filtered to only include relevant sections */
+/* the floor has already been filtered to only include relevant sections.
+   The quantized floor and the lines above the fit threshold are kept
+   in quant[] and above[] for inspect_error(), which would otherwise
+   redo the quantization every time it walks over a range */
 static int accumulate_fit(const float *flr,const float *mdct,
+                          int *quant,unsigned char *above,
                           int x0, int x1,lsfit_acc *a,
                           int n,vorbis_info_floor1 *info){
   long i;
@@ -433,8 +445,10 @@ static int accumulate_fit(const float *flr,const float *mdct,
 
   for(i=x0;i<=x1;i++){
     int quantized=vorbis_dBquant(flr+i);
+    quant[i]=quantized;
+    above[i]=(mdct[i]+info->twofitatten>=flr[i]);
     if(quantized){
-      if(mdct[i]+info->twofitatten>=flr[i]){
+      if(above[i]){
         xa  += i;
         ya  += quantized;
         x2a += i*i;
@@ -466,32 +480,37 @@ static int accumulate_fit(const float *flr,const float *mdct,
   a->xyb=xyb;
   a->bn=nb;
 
+  {
+    double weight=(nb+na)*info->twofitweight/(na+1)+1.;
+    a->wx=xb+xa*weight;
+    a->wy=yb+ya*weight;
+    a->wx2=x2b+x2a*weight;
+    a->wxy=xyb+xya*weight;
+    a->wn=nb+na*weight;
+  }
+
   return(na);
 }
 
 static int fit_line(lsfit_acc *a,int fits,int *y0,int *y1,
                     vorbis_info_floor1 *info){
-  double xb=0,yb=0,x2b=0,y2b=0,xyb=0,bn=0;
+  double xb=0,yb=0,x2b=0,xyb=0,bn=0;
   int i;
   int x0=a[0].x0;
   int x1=a[fits-1].x1;
 
   for(i=0;i<fits;i++){
-    double weight = (a[i].bn+a[i].an)*info->twofitweight/(a[i].an+1)+1.;
-
-    xb+=a[i].xb + a[i].xa * weight;
-    yb+=a[i].yb + a[i].ya * weight;
-    x2b+=a[i].x2b + a[i].x2a * weight;
-    y2b+=a[i].y2b + a[i].y2a * weight;
-    xyb+=a[i].xyb + a[i].xya * weight;
-    bn+=a[i].bn + a[i].an * weight;
+    xb+=a[i].wx;
+    yb+=a[i].wy;
+    x2b+=a[i].wx2;
+    xyb+=a[i].wxy;
+    bn+=a[i].wn;
   }
 
   if(*y0>=0){
     xb+=   x0;
     yb+=  *y0;
     x2b+=  x0 *  x0;
-    y2b+= *y0 * *y0;
     xyb+= *y0 *  x0;
     bn++;
   }
@@ -500,7 +519,6 @@ static int fit_line(lsfit_acc *a,int fits,int *y0,int *y1,
     xb+=   x1;
     yb+=  *y1;
     x2b+=  x1 *  x1;
-    y2b+= *y1 * *y1;
     xyb+= *y1 *  x1;
     bn++;
   }
@@ -529,8 +547,8 @@ static int fit_line(lsfit_acc *a,int fits,int *y0,int *y1,
   }
 }
 
-static int inspect_error(int x0,int x1,int y0,int y1,const float *mask,
-                         const float *mdct,
+static int inspect_error(int x0,int x1,int y0,int y1,const int *quant,
+                         const unsigned char *above,
                          vorbis_info_floor1 *info){
   int dy=y1-y0;
   int adx=x1-x0;
@@ -540,7 +558,7 @@ static int inspect_error(int x0,int x1,int y0,int y1,const float *mask,
   int x=x0;
   int y=y0;
   int err=0;
-  int val=vorbis_dBquant(mask+x);
+  int val=quant[x];
   int mse=0;
   int n=0;
 
@@ -549,7 +567,7 @@ static int inspect_error(int x0,int x1,int y0,int y1,const float *mask,
   mse=(y-val);
   mse*=mse;
   n++;
-  if(mdct[x]+info->twofitatten>=mask[x]){
+  if(above[x]){
     if(y+info->maxover<val)return(1);
     if(y-info->maxunder>val)return(1);
   }
@@ -563,10 +581,10 @@ static int inspect_error(int x0,int x1,int y0,int y1,const float *mask,
       y+=base;
     }
 
-    val=vorbis_dBquant(mask+x);
+    val=quant[x];
     mse+=((y-val)*(y-val));
     n++;
-    if(mdct[x]+info->twofitatten>=mask[x]){
+    if(above[x]){
       if(val){
         if(y+info->maxover<val)return(1);
         if(y-info->maxunder>val)return(1);
@@ -591,7 +609,8 @@ static int post_Y(int *A,int *B,int pos){
 
 int *floor1_fit(vorbis_block *vb,vorbis_look_floor1 *look,
                           const float *logmdct,   /* in */
-                          const float *logmask){
+                          const float *logmask,
+                          int *output){
   long i,j;
   vorbis_info_floor1 *info=look->vi;
   long n=look->n;
@@ -603,9 +622,11 @@ int *floor1_fit(vorbis_block *vb,vorbis_look_floor1 *look,
 
   int loneighbor[VIF_POSIT+2]; /* sorted index of range list position (+2) */
   int hineighbor[VIF_POSIT+2];
-  int *output=NULL;
   int memo[VIF_POSIT+2];
 
+  int *quant=alloca(n*sizeof(*quant));
+  unsigned char *above=alloca(n*sizeof(*above));
+
   for(i=0;i<posts;i++)fit_valueA[i]=-200; /* mark all unused */
   for(i=0;i<posts;i++)fit_valueB[i]=-200; /* mark all unused */
   for(i=0;i<posts;i++)loneighbor[i]=0; /* 0 for the implicit 0 post */
@@ -615,10 +636,11 @@ int *floor1_fit(vorbis_block *vb,vorbis_look_floor1 *look,
   /* quantize the relevant floor points and collect them into line fit
      structures (one per minimal division) at the same time */
   if(posts==0){
-    nonzero+=accumulate_fit(logmask,logmdct,0,n,fits,n,info);
+    nonzero+=accumulate_fit(logmask,logmdct,quant,above,0,n,fits,n,info);
   }else{
     for(i=0;i<posts-1;i++)
-      nonzero+=accumulate_fit(logmask,logmdct,look->sorted_index[i],
+      nonzero+=accumulate_fit(logmask,logmdct,quant,above,
+                              look->sorted_index[i],
                               look->sorted_index[i+1],fits+i,
                               n,info);
   }
@@ -661,7 +683,7 @@ int *floor1_fit(vorbis_block *vb,vorbis_look_floor1 *look,
             exit(1);
           }
 
-          if(inspect_error(lx,hx,ly,hy,logmask,logmdct,info)){
+          if(inspect_error(lx,hx,ly,hy,quant,above,info)){
             /* outside error bounds/begin search area.  Split it. */
             int ly0=-200;
             int ly1=-200;
@@ -713,8 +735,6 @@ int *floor1_fit(vorbis_block *vb,vorbis_look_floor1 *look,
       }
     }
 
-    output=_vorbis_block_alloc(vb,sizeof(*output)*posts);
-
     output[0]=post_Y(fit_valueA,fit_valueB,0);
     output[1]=post_Y(fit_valueA,fit_valueB,1);
 
@@ -738,31 +758,31 @@ int *floor1_fit(vorbis_block *vb,vorbis_look_floor1 *look,
         output[i]= predicted|0x8000;
       }
     }
-  }
 
-  return(output);
+    return(output);
+  }
 
+  return(NULL);
 }
 
 int *floor1_interpolate_fit(vorbis_block *vb,vorbis_look_floor1 *look,
                           int *A,int *B,
-                          int del){
+                          int del,
+                          int *output){
 
   long i;
   long posts=look->posts;
-  int *output=NULL;
 
   if(A && B){
-    output=_vorbis_block_alloc(vb,sizeof(*output)*posts);
-
     /* overly simpleminded--- look again post 1.2 */
     for(i=0;i<posts;i++){
       output[i]=((65536-del)*(A[i]&0x7fff)+del*(B[i]&0x7fff)+32768)>>16;
       if(A[i]&0x8000 && B[i]&0x8000)output[i]|=0x8000;
     }
+    return(output);
   }
 
-  return(output);
+  return(NULL);
 }
 
 
@@ -851,8 +871,12 @@ int floor1_encode(oggpack_buffer *opb,vorbis_block *vb,
     oggpack_write(opb,1,1);
 
     /* beginning/end post */
+#ifdef TRAIN_FLOOR1
+    /* the bit counters in the look are shared by every block being
+       encoded, so they're only kept up when training */
     look->frames++;
     look->postbits+=ilog(look->quant_q-1)*2;
+#endif
     oggpack_write(opb,out[0],ilog(look->quant_q-1));
     oggpack_write(opb,out[1],ilog(look->quant_q-1));
 
@@ -891,7 +915,9 @@ int floor1_encode(oggpack_buffer *opb,vorbis_block *vb,
           cshift+=csubbits;
         }
         /* write it */
+#ifdef TRAIN_FLOOR1
         look->phrasebits+=
+#endif
           vorbis_book_encode(books+info->class_book[class],cval,opb);
 
 #ifdef TRAIN_FLOOR1
@@ -913,8 +939,10 @@ int floor1_encode(oggpack_buffer *opb,vorbis_block *vb,
         if(book>=0){
           /* hack to allow training with 'bad' books */
           if(out[j+k]<(books+book)->entries)
-            look->postbits+=vorbis_book_encode(books+book,
-                                               out[j+k],opb);
+#ifdef TRAIN_FLOOR1
+            look->postbits+=
+#endif
+              vorbis_book_encode(books+book,out[j+k],opb);
           /*else
             fprintf(stderr,"+!");*/
 
@@ -27,6 +27,7 @@
 #include "registry.h"
 #include "psy.h"
 #include "misc.h"
+#include "simd.h"
 
 /* simplistic, wasteful way of doing this (unique lookup for each
    mode/submapping); there should be a central repository for
@@ -235,29 +236,21 @@ static float FLOOR1_fromdB_LOOKUP[256]={
 #endif
 
 
-static int mapping0_forward(vorbis_block *vb){
+/* first half of the analysis: window, MDCT and FFT of each channel,
+   leaving the log spectrum in vb->pcm and each channel's peak in
+   local_ampmax.  Only block-local state is written, so this may run
+   on several blocks of the same stream at once */
+static int mapping0_transform(vorbis_block *vb){
   vorbis_dsp_state      *vd=vb->vd;
   vorbis_info           *vi=vd->vi;
   codec_setup_info      *ci=vi->codec_setup;
   private_state         *b=vb->vd->backend_state;
   vorbis_block_internal *vbi=(vorbis_block_internal *)vb->internal;
   int                    n=vb->pcmend;
-  int i,j,k;
+  int i,j;
 
-  int    *nonzero    = alloca(sizeof(*nonzero)*vi->channels);
-  float  **gmdct     = _vorbis_block_alloc(vb,vi->channels*sizeof(*gmdct));
-  int    **iwork      = _vorbis_block_alloc(vb,vi->channels*sizeof(*iwork));
-  int ***floor_posts = _vorbis_block_alloc(vb,vi->channels*sizeof(*floor_posts));
-
-  float global_ampmax=vbi->ampmax;
-  float *local_ampmax=alloca(sizeof(*local_ampmax)*vi->channels);
-  int blocktype=vbi->blocktype;
-
-  int modenumber=vb->W;
-  vorbis_info_mapping0 *info=ci->map_param[modenumber];
-  vorbis_look_psy *psy_look=b->psy+blocktype+(vb->W?2:0);
-
-  vb->mode=modenumber;
+  float  **gmdct     = vbi->gmdct;
+  float *local_ampmax=vbi->local_ampmax;
 
   for(i=0;i<vi->channels;i++){
     float scale=4.f/n;
@@ -266,9 +259,6 @@ static int mapping0_forward(vorbis_block *vb){
     float *pcm     =vb->pcm[i];
     float *logfft  =pcm;
 
-    iwork[i]=_vorbis_block_alloc(vb,n/2*sizeof(**iwork));
-    gmdct[i]=_vorbis_block_alloc(vb,n/2*sizeof(**gmdct));
-
     scale_dB=todB(&scale) + .345; /* + .345 is a hack; the original
                                      todB estimation used on IEEE 754
                                      compliant machines had a bug that
@@ -351,7 +341,6 @@ static int mapping0_forward(vorbis_block *vb){
     }
 
     if(local_ampmax[i]>0.f)local_ampmax[i]=0.f;
-    if(local_ampmax[i]>global_ampmax)global_ampmax=local_ampmax[i];
 
 #if 0
     if(vi->channels==2){
@@ -366,16 +355,47 @@ static int mapping0_forward(vorbis_block *vb){
 #endif
 
   }
+  return(0);
+}
+
+/* second half: psychoacoustics, floor fit and residue coding.  Expects
+   vorbis_analysis_ampmax() to have folded this block's peak into
+   vbi->ampmax */
+static int mapping0_forward(vorbis_block *vb){
+  vorbis_dsp_state      *vd=vb->vd;
+  vorbis_info           *vi=vd->vi;
+  codec_setup_info      *ci=vi->codec_setup;
+  private_state         *b=vb->vd->backend_state;
+  vorbis_block_internal *vbi=(vorbis_block_internal *)vb->internal;
+  int                    n=vb->pcmend;
+  int i,j,k;
+
+  /* all working vectors are preallocated in the block internals */
+  int    *nonzero    = vbi->nonzero;
+  float  **gmdct     = vbi->gmdct;
+  int    **iwork     = vbi->iwork;
+  int ***floor_posts = vbi->floor_posts;
+
+  float global_ampmax=vbi->ampmax;
+  float *local_ampmax=vbi->local_ampmax;
+  int blocktype=vbi->blocktype;
+
+  int modenumber=vb->W;
+  vorbis_info_mapping0 *info=ci->map_param[modenumber];
+  vorbis_look_psy *psy_look=b->psy+blocktype+(vb->W?2:0);
+
+  vb->mode=modenumber;
 
   {
-    float   *noise        = _vorbis_block_alloc(vb,n/2*sizeof(*noise));
-    float   *tone         = _vorbis_block_alloc(vb,n/2*sizeof(*tone));
+    float   *noise        = vbi->noise;
+    float   *tone         = vbi->tone;
 
     for(i=0;i<vi->channels;i++){
       /* the encoder setup assumes that all the modes used by any
          specific bitrate tweaking use the same floor */
 
       int submap=info->chmuxlist[i];
+      int *post_store=vbi->floor_store+i*PACKETBLOBS*(VIF_POSIT+2);
 
       /* the following makes things clearer to *me* anyway */
       float *mdct    =gmdct[i];
@@ -386,7 +406,6 @@ static int mapping0_forward(vorbis_block *vb){
 
       vb->mode=modenumber;
 
-      floor_posts[i]=_vorbis_block_alloc(vb,PACKETBLOBS*sizeof(**floor_posts));
       memset(floor_posts[i],0,sizeof(**floor_posts)*PACKETBLOBS);
 
       for(j=0;j<n/2;j++)
@@ -508,7 +527,8 @@ static int mapping0_forward(vorbis_block *vb){
       floor_posts[i][PACKETBLOBS/2]=
         floor1_fit(vb,b->flr[info->floorsubmap[submap]],
                    logmdct,
-                   logmask);
+                   logmask,
+                   post_store+(PACKETBLOBS/2)*(VIF_POSIT+2));
 
       /* are we managing bitrate?  If so, perform two more fits for
          later rate tweaking (fits represent hi/lo) */
@@ -537,7 +557,8 @@ static int mapping0_forward(vorbis_block *vb){
         floor_posts[i][PACKETBLOBS-1]=
           floor1_fit(vb,b->flr[info->floorsubmap[submap]],
                      logmdct,
-                     logmask);
+                     logmask,
+                     post_store+(PACKETBLOBS-1)*(VIF_POSIT+2));
 
         /* lower rate by way of higher noise curve */
         _vp_offset_and_mix(psy_look,
@@ -562,7 +583,8 @@ static int mapping0_forward(vorbis_block *vb){
         floor_posts[i][0]=
           floor1_fit(vb,b->flr[info->floorsubmap[submap]],
                      logmdct,
-                     logmask);
+                     logmask,
+                     post_store);
 
         /* we also interpolate a range of intermediate curves for
            intermediate rates */
@@ -571,17 +593,18 @@ static int mapping0_forward(vorbis_block *vb){
             floor1_interpolate_fit(vb,b->flr[info->floorsubmap[submap]],
                                    floor_posts[i][0],
                                    floor_posts[i][PACKETBLOBS/2],
-                                   k*65536/(PACKETBLOBS/2));
+                                   k*65536/(PACKETBLOBS/2),
+                                   post_store+k*(VIF_POSIT+2));
         for(k=PACKETBLOBS/2+1;k<PACKETBLOBS-1;k++)
           floor_posts[i][k]=
             floor1_interpolate_fit(vb,b->flr[info->floorsubmap[submap]],
                                    floor_posts[i][PACKETBLOBS/2],
                                    floor_posts[i][PACKETBLOBS-1],
-                                   (k-PACKETBLOBS/2)*65536/(PACKETBLOBS/2));
+                                   (k-PACKETBLOBS/2)*65536/(PACKETBLOBS/2),
+                                   post_store+k*(VIF_POSIT+2));
       }
     }
   }
-  vbi->ampmax=global_ampmax;
 
   /*
     the next phases are performed once for vbr-only and PACKETBLOB
@@ -598,8 +621,8 @@ static int mapping0_forward(vorbis_block *vb){
   /* iterate over the many masking curve fits we've created */
 
   {
-    int **couple_bundle=alloca(sizeof(*couple_bundle)*vi->channels);
-    int *zerobundle=alloca(sizeof(*zerobundle)*vi->channels);
+    int **couple_bundle=vbi->couple_bundle;
+    int *zerobundle=vbi->zerobundle;
 
     for(k=(vorbis_bitrate_managed(vb)?0:PACKETBLOBS/2);
         k<=(vorbis_bitrate_managed(vb)?PACKETBLOBS-1:PACKETBLOBS/2);
@@ -703,6 +726,41 @@ static int mapping0_forward(vorbis_block *vb){
   return(0);
 }
 
+/* square polar channel decoupling of n coefficients, in place.  The
+   four sign cases reduce to: the channel whose sign doesn't decide
+   keeps mag, the other gets mag+ang or mag-ang, minus exactly when
+   mag and ang are both positive or both not.  Worked out that way it
+   needs no branches, which matters as real audio makes the signs
+   unpredictable */
+void mapping0_decouple(float *mag,float *ang,long n){
+  long j=0;
+
+#ifdef VORBIS_SIMD
+  {
+    v4sf zero=v4_zero();
+    v4sf sign=v4_set1(-0.f);
+    for(;j+4<=n;j+=4){
+      v4sf m  = v4_load(mag+j);
+      v4sf a  = v4_load(ang+j);
+      v4sf mp = v4_cmpgt(m,zero);
+      v4sf ap = v4_cmpgt(a,zero);
+      v4sf d  = v4_add(m,v4_xor(a,v4_andnot(v4_xor(mp,ap),sign)));
+      v4_store(mag+j,v4_select(ap,m,d));
+      v4_store(ang+j,v4_select(ap,d,m));
+    }
+  }
+#endif
+
+  for(;j<n;j++){
+    float m=mag[j];
+    float a=ang[j];
+    float d=((m>0)==(a>0)?m-a:m+a);
+
+    mag[j]=(a>0?m:d);
+    ang[j]=(a>0?d:m);
+  }
+}
+
 static int mapping0_inverse(vorbis_block *vb,vorbis_info_mapping *l){
   vorbis_dsp_state     *vd=vb->vd;
   vorbis_info          *vi=vd->vi;
@@ -759,32 +817,9 @@ static int mapping0_inverse(vorbis_block *vb,vorbis_info_mapping *l){
   }
 
   /* channel coupling */
-  for(i=info->coupling_steps-1;i>=0;i--){
-    float *pcmM=vb->pcm[info->coupling_mag[i]];
-    float *pcmA=vb->pcm[info->coupling_ang[i]];
-
-    for(j=0;j<n/2;j++){
-      float mag=pcmM[j];
-      float ang=pcmA[j];
-
-      if(mag>0)
-        if(ang>0){
-          pcmM[j]=mag;
-          pcmA[j]=mag-ang;
-        }else{
-          pcmA[j]=mag;
-          pcmM[j]=mag+ang;
-        }
-      else
-        if(ang>0){
-          pcmM[j]=mag;
-          pcmA[j]=mag+ang;
-        }else{
-          pcmA[j]=mag;
-          pcmM[j]=mag-ang;
-        }
-    }
-  }
+  for(i=info->coupling_steps-1;i>=0;i--)
+    mapping0_decouple(vb->pcm[info->coupling_mag[i]],
+                      vb->pcm[info->coupling_ang[i]],n/2);
 
   /* compute and apply spectral envelope */
   for(i=0;i<vi->channels;i++){
@@ -811,6 +846,7 @@ const vorbis_func_mapping mapping0_exportbundle={
   &mapping0_pack,
   &mapping0_unpack,
   &mapping0_free_info,
+  &mapping0_transform,
   &mapping0_forward,
   &mapping0_inverse
 };
@@ -45,6 +45,11 @@
 #include "mdct.h"
 #include "os.h"
 #include "misc.h"
+#include "simd.h"
+
+#if defined(VORBIS_SIMD) && !defined(MDCT_INTEGERIZED)
+#define MDCT_SIMD
+#endif
 
 /* build lookups for trig functions; also pre-figure scaling and
    some window function algebra. */
@@ -88,6 +93,33 @@ void mdct_init(mdct_lookup *lookup,int n){
     }
   }
   lookup->scale=FLOAT_CONV(4.f/n);
+  lookup->vtrig=NULL;
+
+#ifdef MDCT_SIMD
+  /* the butterfly stages take their twiddles four pairs at a time;
+     stage s of the n/2 point butterflies steps through T by 4<<s, and
+     its four pairs per iteration sit in memory in the reverse order of
+     the twiddles they use.  Lay the twiddles out as the vector loop
+     reads them: per iteration four cosines, then four sines */
+  {
+    int stages=log2n-6,s,j,k;
+    DATA_TYPE *V;
+    if(stages>0){
+      V=lookup->vtrig=_ogg_malloc(sizeof(*V)*n2);
+      for(s=0;s<stages;s++){
+        int iterations=(n2>>s)/16;
+        for(i=0;i<iterations;i++){
+          for(j=0;j<4;j++){
+            k=(4*i+3-j)*(4<<s);
+            V[j]=T[k];
+            V[4+j]=T[k+1];
+          }
+          V+=8;
+        }
+      }
+    }
+  }
+#endif
 }
 
 /* 8 point butterfly (in place, 4 register) */
@@ -314,6 +346,43 @@ STIN void mdct_butterfly_generic(DATA_TYPE *T,
   }while(x2>=x);
 }
 
+#ifdef MDCT_SIMD
+/* mdct_butterfly_first/generic with four pairs to a vector; the same
+   operations in the same order, so the results are the same */
+STIN void mdct_butterfly_simd(const DATA_TYPE *V,
+                              DATA_TYPE *x,
+                              int points){
+
+  DATA_TYPE *x1        = x          + points      - 8;
+  DATA_TYPE *x2        = x          + (points>>1) - 8;
+
+  do{
+    v4sf a  = v4_load(x1);
+    v4sf b  = v4_load(x1+4);
+    v4sf c  = v4_load(x2);
+    v4sf d  = v4_load(x2+4);
+    v4sf r0 = v4_sub(a,c);
+    v4sf r1 = v4_sub(b,d);
+    v4sf re = v4_even(r0,r1);
+    v4sf im = v4_odd(r0,r1);
+    v4sf tc = v4_load(V);
+    v4sf ts = v4_load(V+4);
+    v4sf yr = v4_add(v4_mul(im,ts),v4_mul(re,tc));
+    v4sf yi = v4_sub(v4_mul(im,tc),v4_mul(re,ts));
+
+    v4_store(x1,v4_add(a,c));
+    v4_store(x1+4,v4_add(b,d));
+    v4_store(x2,v4_ziplo(yr,yi));
+    v4_store(x2+4,v4_ziphi(yr,yi));
+
+    x1-=8;
+    x2-=8;
+    V+=8;
+
+  }while(x2>=x);
+}
+#endif
+
 STIN void mdct_butterflies(mdct_lookup *init,
                              DATA_TYPE *x,
                              int points){
@@ -322,6 +391,20 @@ STIN void mdct_butterflies(mdct_lookup *init,
   int stages=init->log2n-5;
   int i,j;
 
+#ifdef MDCT_SIMD
+  if(init->vtrig){
+    DATA_TYPE *V=init->vtrig;
+    for(i=0;--stages>0;i++){
+      for(j=0;j<(1<<i);j++)
+        mdct_butterfly_simd(V,x+(points>>i)*j,points>>i);
+      V+=(points>>i)/2;
+    }
+    for(j=0;j<points;j+=32)
+      mdct_butterfly_32(x+j);
+    return;
+  }
+#endif
+
   if(--stages>0){
     mdct_butterfly_first(T,x,points);
   }
@@ -340,10 +423,18 @@ void mdct_clear(mdct_lookup *l){
   if(l){
     if(l->trig)_ogg_free(l->trig);
     if(l->bitrev)_ogg_free(l->bitrev);
+    if(l->vtrig)_ogg_free(l->vtrig);
     memset(l,0,sizeof(*l));
   }
 }
 
+/* drops vtrig, which only holds a copy of trig in another order; the
+   butterflies then take the scalar path, with the same results */
+void mdct_lowmem(mdct_lookup *l){
+  if(l->vtrig)_ogg_free(l->vtrig);
+  l->vtrig=NULL;
+}
+
 STIN void mdct_bitreverse(mdct_lookup *init,
                             DATA_TYPE *x){
   int        n       = init->n;
@@ -440,6 +531,26 @@ void mdct_backward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
     DATA_TYPE *iX =out;
     T             =init->trig+n2;
 
+#ifdef MDCT_SIMD
+    do{
+      v4sf a  = v4_load(iX);
+      v4sf b  = v4_load(iX+4);
+      v4sf c  = v4_load(T);
+      v4sf d  = v4_load(T+4);
+      v4sf re = v4_even(a,b);
+      v4sf im = v4_odd(a,b);
+      v4sf tr = v4_even(c,d);
+      v4sf ti = v4_odd(c,d);
+
+      oX1-=4;
+      v4_store(oX1,v4_reverse(v4_sub(v4_mul(re,ti),v4_mul(im,tr))));
+      v4_store(oX2,v4_neg(v4_add(v4_mul(re,tr),v4_mul(im,ti))));
+
+      oX2+=4;
+      iX    +=   8;
+      T     +=   8;
+    }while(iX<oX1);
+#else
     do{
       oX1-=4;
 
@@ -459,6 +570,7 @@ void mdct_backward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
       iX    +=   8;
       T     +=   8;
     }while(iX<oX1);
+#endif
 
     iX=out+n2+n4;
     oX1=out+n4;
@@ -553,6 +665,27 @@ void mdct_forward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
   T=init->trig+n2;
   x0=out+n2;
 
+#ifdef MDCT_SIMD
+  {
+    v4sf scale=v4_set1(init->scale);
+    for(i=0;i<n4;i+=4){
+      v4sf a  = v4_load(w);
+      v4sf b  = v4_load(w+4);
+      v4sf c  = v4_load(T);
+      v4sf d  = v4_load(T+4);
+      v4sf re = v4_even(a,b);
+      v4sf im = v4_odd(a,b);
+      v4sf tr = v4_even(c,d);
+      v4sf ti = v4_odd(c,d);
+
+      x0-=4;
+      v4_store(out+i,v4_mul(v4_add(v4_mul(re,tr),v4_mul(im,ti)),scale));
+      v4_store(x0,v4_reverse(v4_mul(v4_sub(v4_mul(re,ti),v4_mul(im,tr)),scale)));
+      w+=8;
+      T+=8;
+    }
+  }
+#else
   for(i=0;i<n4;i++){
     x0--;
     out[i] =MULT_NORM((w[0]*T[0]+w[1]*T[1])*init->scale);
@@ -560,4 +693,5 @@ void mdct_forward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
     w+=2;
     T+=2;
   }
+#endif
 }
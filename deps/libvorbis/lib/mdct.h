@@ -59,12 +59,15 @@ typedef struct {
 
   DATA_TYPE *trig;
   int       *bitrev;
+  DATA_TYPE *vtrig;   /* butterfly twiddles in vector lane order; only
+                         built for the SIMD path */
 
   DATA_TYPE scale;
 } mdct_lookup;
 
 extern void mdct_init(mdct_lookup *lookup,int n);
 extern void mdct_clear(mdct_lookup *l);
+extern void mdct_lowmem(mdct_lookup *l);
 extern void mdct_forward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out);
 extern void mdct_backward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out);
 
@@ -28,6 +28,7 @@
 #include "smallft.h"
 #include "scales.h"
 #include "misc.h"
+#include "simd.h"
 
 #define NEGINF -9999.f
 static const double stereo_threshholds[]={0.0, .5, 1.0, 1.5, 2.5, 4.5, 8.5, 16.5, 9e10};
@@ -541,6 +542,20 @@ static void max_seeds(vorbis_look_psy *p,
 
 }
 
+#ifdef VORBIS_SIMD
+/* (A + x * B) / D of bark_noise_hybridmp for four bins at once, from
+   their windowed sums; the same operations in the same order as the
+   scalar loops, so the results are the same too */
+STIN v4sf bark_fit4(v4sf tN,v4sf tX,v4sf tXX,v4sf tY,v4sf tXY,v4sf x){
+  v4sf A=v4_sub(v4_mul(tY,tXX),v4_mul(tX,tXY));
+  v4sf B=v4_sub(v4_mul(tN,tXY),v4_mul(tX,tY));
+  v4sf D=v4_sub(v4_mul(tN,tXX),v4_mul(tX,tX));
+  return v4_div(v4_add(A,v4_mul(x,B)),D);
+}
+
+static const float bark_ramp[4]={0.f,1.f,2.f,3.f};
+#endif
+
 static void bark_noise_hybridmp(int n,const long *b,
                                 const float *f,
                                 float *noise,
@@ -671,6 +686,25 @@ static void bark_noise_hybridmp(int n,const long *b,
 
     if (R - offset < noise[i]) noise[i] = R - offset;
   }
+
+#ifdef VORBIS_SIMD
+  /* fixed windows slide by one bin, so their sums are plain loads */
+  for ( ; i + fixed / 2 + 4 < n; i += 4, x += 4.f) {
+    v4sf r, v;
+    hi = i + fixed / 2;
+    lo = hi - fixed;
+    r = bark_fit4(v4_sub(v4_load(N+hi), v4_load(N+lo)),
+                  v4_sub(v4_load(X+hi), v4_load(X+lo)),
+                  v4_sub(v4_load(XX+hi), v4_load(XX+lo)),
+                  v4_sub(v4_load(Y+hi), v4_load(Y+lo)),
+                  v4_sub(v4_load(XY+hi), v4_load(XY+lo)),
+                  v4_add(v4_set1(x), v4_load(bark_ramp)));
+    r = v4_sub(r, v4_set1(offset));
+    v = v4_load(noise+i);
+    v4_store(noise+i, v4_select(v4_cmpgt(v, r), r, v));
+  }
+#endif
+
   for ( ;; i++, x += 1.f) {
 
     hi = i + fixed / 2;
@@ -702,6 +736,7 @@ void _vp_noisemask(vorbis_look_psy *p,
 
   int i,n=p->n;
   float *work=alloca(n*sizeof(*work));
+  const float *compand=p->vi->noisecompand;
 
   bark_noise_hybridmp(n,p->bark,logmdct,logmask,
                       140.,-1);
@@ -739,7 +774,7 @@ void _vp_noisemask(vorbis_look_psy *p,
     int dB=logmask[i]+.5;
     if(dB>=NOISE_COMPAND_LEVELS)dB=NOISE_COMPAND_LEVELS-1;
     if(dB<0)dB=0;
-    logmask[i]= work[i]+p->vi->noisecompand[dB];
+    logmask[i]= work[i]+compand[dB];
   }
 
 }
@@ -827,12 +862,12 @@ void _vp_offset_and_mix(vorbis_look_psy *p,
   }
 }
 
-float _vp_ampmax_decay(float amp,vorbis_dsp_state *vd){
-  vorbis_info *vi=vd->vi;
+float _vp_ampmax_decay(float amp,vorbis_block *vb){
+  vorbis_info *vi=vb->vd->vi;
   codec_setup_info *ci=vi->codec_setup;
   vorbis_info_psy_global *gi=&ci->psy_g_param;
 
-  int n=ci->blocksizes[vd->W]/2;
+  int n=ci->blocksizes[vb->W]/2;
   float secs=(float)n/vi->rate;
 
   amp+=secs*gi->ampmax_att_per_sec;
@@ -907,11 +942,37 @@ static float FLOOR1_fromdB_LOOKUP[256]={
   0.82788260F, 0.88168307F, 0.9389798F, 1.F,
 };
 
-/* this is for per-channel noise normalization */
-static int apsort(const void *a, const void *b){
-  float f1=**(float**)a;
-  float f2=**(float**)b;
-  return (f1<f2)-(f1>f2);
+/* this is for per-channel noise normalization.  Orders by descending
+   magnitude; equal magnitudes keep their order in the partition, as a
+   stable sort would leave them */
+#define AP_BEFORE(a,b) (*(a)>*(b) || (*(a)==*(b) && (a)<(b)))
+
+/* partially orders sort[] so that its first m entries are the m that a
+   full sort would put there; a quickselect, linear on average */
+static void apselect(float **sort, int count, int m){
+  int lo=0,hi=count-1,k=m-1;
+
+  while(lo<hi){
+    float *pivot=sort[lo+((hi-lo)>>1)];
+    int i=lo,j=hi;
+
+    while(i<=j){
+      while(AP_BEFORE(sort[i],pivot))i++;
+      while(AP_BEFORE(pivot,sort[j]))j--;
+      if(i<=j){
+        float *t=sort[i];
+        sort[i++]=sort[j];
+        sort[j--]=t;
+      }
+    }
+
+    if(k<=j)
+      hi=j;
+    else if(k>=i)
+      lo=i;
+    else
+      break;
+  }
 }
 
 static void flag_lossless(int limit, float prepoint, float postpoint, float *mdct,
@@ -984,13 +1045,21 @@ static float noise_normalize(vorbis_look_psy *p, int limit, float *r, float *q,
   }
 
   if(count){
-    /* noise norm to do */
-    qsort(sort,count,sizeof(*sort),apsort);
+    /* noise norm to do.  Going down the magnitudes, elements are
+       promoted to unit magnitude for as long as acc lasts and zeroed
+       after that; so what matters is which ones are the m largest, not
+       the order they come in */
+    int m;
+    for(m=0;m<count && acc>=vi->normal_thresh;m++)
+      acc-=1.f;
+
+    if(m>0 && m<count)
+      apselect(sort,count,m);
+
     for(j=0;j<count;j++){
       int k=sort[j]-q;
-      if(acc>=vi->normal_thresh){
+      if(j<m){
         out[k]=unitnorm(r[k]);
-        acc-=1.f;
         q[k]=f[k];
       }else{
         out[k]=0;
@@ -50,7 +50,7 @@ typedef struct {
   int         partvals;
   int       **decodemap;
 
-  long      postbits;
+  long      postbits;   /* bit usage statistics; only kept when training */
   long      phrasebits;
   long      frames;
 
@@ -337,7 +337,23 @@ static int local_book_besterror(codebook *book,int *a){
   /* assumes integer/centered encoder codebook maptype 1 no more than dim 8 */
   int p[8]={0,0,0,0,0,0,0,0};
 
-  if(del!=1){
+  if(book->enc_lattice){
+    const int *lattice=book->enc_lattice;
+    unsigned int len=book->enc_latticelen;
+    int lmin=book->enc_latticemin;
+    for(i=0,o=dim;i<dim;i++){
+      unsigned int l=(unsigned int)a[--o]-(unsigned int)lmin;
+      if(l<len){
+        index = index*qv+lattice[l*2];
+        p[o]=lattice[l*2+1];
+      }else{
+        int v = (a[o]-minval+(del>>1))/del;
+        int m = (v<ze ? ((ze-v)<<1)-1 : ((v-ze)<<1));
+        index = index*qv+ (m<0?0:(m>=qv?qv-1:m));
+        p[o]=v*del+minval;
+      }
+    }
+  }else if(del!=1){
     for(i=0,o=dim;i<dim;i++){
       int v = (a[--o]-minval+(del>>1))/del;
       int m = (v<ze ? ((ze-v)<<1)-1 : ((v-ze)<<1));
@@ -423,7 +439,8 @@ static long **_01class(vorbis_block *vb,vorbis_look_residue *vl,
   int n=info->end-info->begin;
 
   int partvals=n/samples_per_partition;
-  long **partword=_vorbis_block_alloc(vb,ch*sizeof(*partword));
+  vorbis_block_internal *vbi=(vorbis_block_internal *)vb->internal;
+  long **partword=vbi->partword;
   float scale=100./samples_per_partition;
 
   /* we find the partition type for each partition of each
@@ -431,7 +448,7 @@ static long **_01class(vorbis_block *vb,vorbis_look_residue *vl,
      bit.  For now, clarity */
 
   for(i=0;i<ch;i++){
-    partword[i]=_vorbis_block_alloc(vb,n/samples_per_partition*sizeof(*partword[i]));
+    partword[i]=vbi->partword_store+i*partvals;
     memset(partword[i],0,n/samples_per_partition*sizeof(*partword[i]));
   }
 
@@ -470,7 +487,9 @@ static long **_01class(vorbis_block *vb,vorbis_look_residue *vl,
     }
   }
 #endif
+#ifdef TRAIN_RES
   look->frames++;
+#endif
 
   return(partword);
 }
@@ -490,14 +509,15 @@ static long **_2class(vorbis_block *vb,vorbis_look_residue *vl,int **in,
   int n=info->end-info->begin;
 
   int partvals=n/samples_per_partition;
-  long **partword=_vorbis_block_alloc(vb,sizeof(*partword));
+  vorbis_block_internal *vbi=(vorbis_block_internal *)vb->internal;
+  long **partword=vbi->partword;
 
 #if defined(TRAIN_RES) || defined (TRAIN_RESAUX)
   FILE *of;
   char buffer[80];
 #endif
 
-  partword[0]=_vorbis_block_alloc(vb,partvals*sizeof(*partword[0]));
+  partword[0]=vbi->partword_store;
   memset(partword[0],0,partvals*sizeof(*partword[0]));
 
   for(i=0,l=info->begin/ch;i<partvals;i++){
@@ -528,7 +548,9 @@ static long **_2class(vorbis_block *vb,vorbis_look_residue *vl,int **in,
   fclose(of);
 #endif
 
+#ifdef TRAIN_RES
   look->frames++;
+#endif
 
   return(partword);
 }
@@ -590,7 +612,10 @@ static int _01forward(oggpack_buffer *opb,
 
           /* training hack */
           if(val<look->phrasebook->entries)
-            look->phrasebits+=vorbis_book_encode(look->phrasebook,val,opb);
+#ifdef TRAIN_RES
+            look->phrasebits+=
+#endif
+              vorbis_book_encode(look->phrasebook,val,opb);
 #if 0 /*def TRAIN_RES*/
           else
             fprintf(stderr,"!");
@@ -628,7 +653,9 @@ static int _01forward(oggpack_buffer *opb,
               ret=encode(opb,in[j]+offset,samples_per_partition,
                          statebook,accumulator);
 
+#ifdef TRAIN_RES
               look->postbits+=ret;
+#endif
               resbits[partword[j][i]]+=ret;
             }
           }
@@ -782,11 +809,11 @@ int res2_forward(oggpack_buffer *opb,
                  vorbis_block *vb,vorbis_look_residue *vl,
                  int **in,int *nonzero,int ch, long **partword,int submap){
   long i,j,k,n=vb->pcmend/2,used=0;
+  vorbis_block_internal *vbi=(vorbis_block_internal *)vb->internal;
 
   /* don't duplicate the code; use a working vector hack for now and
      reshape ourselves into a single channel res1 */
-  /* ugly; reallocs for each coupling pass :-( */
-  int *work=_vorbis_block_alloc(vb,ch*n*sizeof(*work));
+  int *work=vbi->reswork;
   for(i=0;i<ch;i++){
     int *pcm=in[i];
     if(nonzero[i])used++;
@@ -258,6 +258,51 @@ float *_book_unquantize(const static_codebook *b,int n,int *sparsemap){
   return(NULL);
 }
 
+/* for a lattice book (maptype 1) without sequencep, the value of each
+   scalar depends on its lattice point alone.  Returns the point of each
+   scalar, in the layout of _book_unquantize(), and the value of each
+   point in *vals; the values come out of the same arithmetic, so they
+   are the same.  NULL if the book is not like that */
+unsigned char *_book_lattice(const static_codebook *b,int n,int *sparsemap,
+                             float **vals){
+  long j,k,count=0;
+  int quantvals;
+  float mindel,delta,last=0.f;
+  unsigned char *r;
+  float *v;
+
+  if(b->maptype!=1 || b->q_sequencep)return(NULL);
+  quantvals=_book_maptype1_quantvals(b);
+  if(quantvals<=0 || quantvals>256)return(NULL);
+
+  mindel=_float32_unpack(b->q_min);
+  delta=_float32_unpack(b->q_delta);
+  v=_ogg_malloc(quantvals*sizeof(*v));
+  for(j=0;j<quantvals;j++){
+    float val=b->quantlist[j];
+    v[j]=fabs(val)*delta+mindel+last;
+  }
+
+  r=_ogg_calloc(n*b->dim,sizeof(*r));
+  for(j=0;j<b->entries;j++){
+    if((sparsemap && b->lengthlist[j]) || !sparsemap){
+      int indexdiv=1;
+      for(k=0;k<b->dim;k++){
+        int index= (j/indexdiv)%quantvals;
+        if(sparsemap)
+          r[sparsemap[count]*b->dim+k]=index;
+        else
+          r[count*b->dim+k]=index;
+        indexdiv*=quantvals;
+      }
+      count++;
+    }
+  }
+
+  *vals=v;
+  return(r);
+}
+
 void vorbis_staticbook_destroy(static_codebook *b){
   if(b->allocedp){
     if(b->quantlist)_ogg_free(b->quantlist);
@@ -274,8 +319,13 @@ void vorbis_book_clear(codebook *b){
   if(b->codelist)_ogg_free(b->codelist);
 
   if(b->dec_index)_ogg_free(b->dec_index);
+  if(b->dec_index16)_ogg_free(b->dec_index16);
+  if(b->dec_lattice)_ogg_free(b->dec_lattice);
+  if(b->dec_latticevals)_ogg_free(b->dec_latticevals);
   if(b->dec_codelengths)_ogg_free(b->dec_codelengths);
   if(b->dec_firsttable)_ogg_free(b->dec_firsttable);
+  if(b->dec_multitable)_ogg_free(b->dec_multitable);
+  if(b->enc_lattice)_ogg_free(b->enc_lattice);
 
   memset(b,0,sizeof(*b));
 }
@@ -293,6 +343,25 @@ int vorbis_book_init_encode(codebook *c,const static_codebook *s){
   c->minval=(int)rint(_float32_unpack(s->q_min));
   c->delta=(int)rint(_float32_unpack(s->q_delta));
 
+  /* cover the lattice plus a step either side; anything further out
+     is rare enough to work out on the spot */
+  if(s->maptype==1 && c->delta>0 && c->quantvals>0){
+    int i;
+    int del=c->delta;
+    int qv=c->quantvals;
+    int ze=qv>>1;
+
+    c->enc_latticemin=c->minval-del;
+    c->enc_latticelen=del*(qv+1)+1;
+    c->enc_lattice=_ogg_malloc(c->enc_latticelen*2*sizeof(*c->enc_lattice));
+    for(i=0;i<c->enc_latticelen;i++){
+      int v=(c->enc_latticemin+i-c->minval+(del>>1))/del;
+      int m=(v<ze ? ((ze-v)<<1)-1 : ((v-ze)<<1));
+      c->enc_lattice[i*2]=(m<0?0:(m>=qv?qv-1:m));
+      c->enc_lattice[i*2+1]=v*del+c->minval;
+    }
+  }
+
   return(0);
 }
 
@@ -310,7 +379,7 @@ static int sort32a(const void *a,const void *b){
 }
 
 /* decode codebook arrangement is more heavily optimized than encode */
-int vorbis_book_init_decode(codebook *c,const static_codebook *s){
+int vorbis_book_init_decode(codebook *c,const static_codebook *s,int lowmem){
   int i,j,n=0,tabn;
   int *sortindex;
   memset(c,0,sizeof(*c));
@@ -362,12 +431,24 @@ int vorbis_book_init_decode(codebook *c,const static_codebook *s){
     _ogg_free(codes);
 
 
-    c->valuelist=_book_unquantize(s,n,sortindex);
-    c->dec_index=_ogg_malloc(n*sizeof(*c->dec_index));
+    /* low-memory mode keeps a byte per scalar rather than a float where
+       it can, and 16 bit entry numbers */
+    if(lowmem)
+      c->dec_lattice=_book_lattice(s,n,sortindex,&c->dec_latticevals);
+    if(!c->dec_lattice)
+      c->valuelist=_book_unquantize(s,n,sortindex);
 
-    for(n=0,i=0;i<s->entries;i++)
-      if(s->lengthlist[i]>0)
-        c->dec_index[sortindex[n++]]=i;
+    if(lowmem && s->entries<=65536){
+      c->dec_index16=_ogg_malloc(n*sizeof(*c->dec_index16));
+      for(n=0,i=0;i<s->entries;i++)
+        if(s->lengthlist[i]>0)
+          c->dec_index16[sortindex[n++]]=i;
+    }else{
+      c->dec_index=_ogg_malloc(n*sizeof(*c->dec_index));
+      for(n=0,i=0;i<s->entries;i++)
+        if(s->lengthlist[i]>0)
+          c->dec_index[sortindex[n++]]=i;
+    }
 
     c->dec_codelengths=_ogg_malloc(n*sizeof(*c->dec_codelengths));
     for(n=0,i=0;i<s->entries;i++)
@@ -419,6 +500,58 @@ int vorbis_book_init_decode(codebook *c,const static_codebook *s){
         }
       }
     }
+
+    /* the multi table: for every possible DEC_MULTITABLEN bit lookahead,
+       the run of up to DEC_MULTI codewords it holds in full.  This is
+       only worth its memory if at least two codewords can fit, and
+       not at all if the caller asked to keep memory down */
+    {
+      int minlength=c->dec_maxlength;
+      for(i=0;i<n;i++)
+        if(minlength>c->dec_codelengths[i])
+          minlength=c->dec_codelengths[i];
+
+      c->dec_multitablen=c->dec_maxlength*DEC_MULTI;
+      if(c->dec_multitablen>DEC_MULTITABLEN)
+        c->dec_multitablen=DEC_MULTITABLEN;
+
+      if(!lowmem && n<=65536 && minlength*2<=c->dec_multitablen){
+        tabn=1<<c->dec_multitablen;
+        c->dec_multitable=_ogg_calloc(tabn,sizeof(*c->dec_multitable));
+
+        for(i=0;i<tabn;i++){
+          dec_multi *m=c->dec_multitable+i;
+          int bits=0;
+
+          while(m->count<DEC_MULTI){
+            /* the same bisection decode_packed_entry_number() does,
+               over the bits of the lookahead not consumed yet */
+            int avail=c->dec_multitablen-bits;
+            ogg_uint32_t look=(ogg_uint32_t)i>>bits;
+            ogg_uint32_t testword=bitreverse(look);
+            long lo=0,hi=n;
+            int length;
+
+            while(hi-lo>1){
+              long p=(hi-lo)>>1;
+              if(c->codelist[lo+p]>testword)
+                hi=lo+p;
+              else
+                lo+=p;
+            }
+
+            length=c->dec_codelengths[lo];
+            if(length>avail ||
+               ((bitreverse(c->codelist[lo])^look)&((1UL<<length)-1)))
+              break;
+
+            bits+=length;
+            m->entry[m->count]=lo;
+            m->bits[m->count++]=bits;
+          }
+        }
+      }
+    }
   }
 
   return(0);
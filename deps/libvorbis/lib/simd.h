@@ -0,0 +1,127 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2009             *
+ * by the Xiph.Org Foundation http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: 4-lane float vectors for the hot loops
+
+ SSE2 on x86 and NEON on ARM; both are part of the baseline of their
+ 64-bit ABIs, so no runtime check is needed.  VORBIS_SIMD is left
+ undefined everywhere else and the callers keep their scalar loops.
+
+ Only plain IEEE adds, subtracts, multiplies and divides are
+ provided, so a vector loop that does the same operations in the same
+ order as its scalar twin gives the same results.  The one caveat is a compiler
+ that fuses multiply-adds (GCC does on ARM by default); then either
+ version may be off from the other by one rounding per fused
+ operation.
+
+ ********************************************************************/
+
+#ifndef _V_SIMD_H_
+#define _V_SIMD_H_
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+#include <emmintrin.h>
+#define VORBIS_SIMD 1
+
+typedef __m128 v4sf;
+
+#define v4_load(p)     _mm_loadu_ps(p)
+#define v4_store(p,a)  _mm_storeu_ps(p,a)
+#define v4_set1(x)     _mm_set1_ps(x)
+#define v4_add(a,b)    _mm_add_ps(a,b)
+#define v4_sub(a,b)    _mm_sub_ps(a,b)
+#define v4_mul(a,b)    _mm_mul_ps(a,b)
+#define v4_div(a,b)    _mm_div_ps(a,b)
+#define v4_neg(a)      _mm_xor_ps(a,_mm_set1_ps(-0.f))
+
+/* a0 a2 b0 b2 and a1 a3 b1 b3: split interleaved pairs */
+#define v4_even(a,b)   _mm_shuffle_ps(a,b,_MM_SHUFFLE(2,0,2,0))
+#define v4_odd(a,b)    _mm_shuffle_ps(a,b,_MM_SHUFFLE(3,1,3,1))
+
+/* a0 b0 a1 b1 and a2 b2 a3 b3: interleave them again */
+#define v4_ziplo(a,b)  _mm_unpacklo_ps(a,b)
+#define v4_ziphi(a,b)  _mm_unpackhi_ps(a,b)
+
+/* a3 a2 a1 a0 */
+#define v4_reverse(a)  _mm_shuffle_ps(a,a,_MM_SHUFFLE(0,1,2,3))
+
+/* lane masks, all ones where true, and bitwise ops on them */
+#define v4_zero()      _mm_setzero_ps()
+#define v4_cmpgt(a,b)  _mm_cmpgt_ps(a,b)
+#define v4_and(a,b)    _mm_and_ps(a,b)
+#define v4_andnot(a,b) _mm_andnot_ps(a,b)   /* ~a & b */
+#define v4_xor(a,b)    _mm_xor_ps(a,b)
+#define v4_select(m,a,b) _mm_or_ps(_mm_and_ps(m,a),_mm_andnot_ps(m,b))
+
+/* |a|, and the bits of a read as a signed integer and converted back to
+   float, rounding to nearest like the scalar cast */
+#define v4_abs(a)      _mm_andnot_ps(_mm_set1_ps(-0.f),a)
+#define v4_bitsf(a)    _mm_cvtepi32_ps(_mm_castps_si128(a))
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+#define VORBIS_SIMD 1
+
+typedef float32x4_t v4sf;
+
+#define v4_load(p)     vld1q_f32(p)
+#define v4_store(p,a)  vst1q_f32(p,a)
+#define v4_set1(x)     vdupq_n_f32(x)
+#define v4_add(a,b)    vaddq_f32(a,b)
+#define v4_sub(a,b)    vsubq_f32(a,b)
+#define v4_mul(a,b)    vmulq_f32(a,b)
+#define v4_neg(a)      vnegq_f32(a)
+
+#define v4_even(a,b)   (vuzpq_f32(a,b).val[0])
+#define v4_odd(a,b)    (vuzpq_f32(a,b).val[1])
+
+#define v4_ziplo(a,b)  (vzipq_f32(a,b).val[0])
+#define v4_ziphi(a,b)  (vzipq_f32(a,b).val[1])
+
+static inline v4sf v4_reverse(v4sf a){
+  a=vrev64q_f32(a);
+  return vcombine_f32(vget_high_f32(a),vget_low_f32(a));
+}
+
+#define v4_u(a)        vreinterpretq_u32_f32(a)
+#define v4_f(a)        vreinterpretq_f32_u32(a)
+#define v4_zero()      vdupq_n_f32(0.f)
+#define v4_cmpgt(a,b)  v4_f(vcgtq_f32(a,b))
+#define v4_and(a,b)    v4_f(vandq_u32(v4_u(a),v4_u(b)))
+#define v4_andnot(a,b) v4_f(vbicq_u32(v4_u(b),v4_u(a)))
+#define v4_xor(a,b)    v4_f(veorq_u32(v4_u(a),v4_u(b)))
+#define v4_select(m,a,b) vbslq_f32(v4_u(m),a,b)
+
+#define v4_abs(a)      vabsq_f32(a)
+#define v4_bitsf(a)    vcvtq_f32_s32(vreinterpretq_s32_f32(a))
+
+/* 32 bit NEON has only a reciprocal estimate, which would not round
+   like the scalar divide */
+#ifdef __aarch64__
+#define v4_div(a,b)    vdivq_f32(a,b)
+#else
+static inline v4sf v4_div(v4sf a,v4sf b){
+  float x[4],y[4];
+  int i;
+  vst1q_f32(x,a);
+  vst1q_f32(y,b);
+  for(i=0;i<4;i++)x[i]/=y[i];
+  return vld1q_f32(x);
+}
+#endif
+
+#endif
+
+#endif
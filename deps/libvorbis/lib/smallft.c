@@ -34,6 +34,7 @@
 #include "smallft.h"
 #include "os.h"
 #include "misc.h"
+#include "simd.h"
 
 static void drfti1(int n, float *wa, int *ifac){
   static int ntryh[4] = { 4,2,3,5 };
@@ -108,7 +109,7 @@ static void drfti1(int n, float *wa, int *ifac){
 static void fdrffti(int n, float *wsave, int *ifac){
 
   if (n == 1) return;
-  drfti1(n, wsave+n, ifac);
+  drfti1(n, wsave, ifac);
 }
 
 static void dradf2(int ido,int l1,float *cc,float *ch,float *wa1){
@@ -136,7 +137,39 @@ static void dradf2(int ido,int l1,float *cc,float *ch,float *wa1){
     t4=(t1<<1)+(ido<<1);
     t5=t1;
     t6=t1+t1;
-    for(i=2;i<ido;i+=2){
+    i=2;
+#ifdef VORBIS_SIMD
+    /* four iterations at a time; same arithmetic as the loop below */
+    for(;i+6<ido;i+=8){
+      v4sf a   = v4_load(cc+t3+1);
+      v4sf b   = v4_load(cc+t3+5);
+      v4sf c   = v4_load(wa1+i-2);
+      v4sf d   = v4_load(wa1+i+2);
+      v4sf e   = v4_load(cc+t5+1);
+      v4sf f   = v4_load(cc+t5+5);
+      v4sf re  = v4_even(a,b);
+      v4sf im  = v4_odd(a,b);
+      v4sf wr  = v4_even(c,d);
+      v4sf wi  = v4_odd(c,d);
+      v4sf cr  = v4_even(e,f);
+      v4sf ci  = v4_odd(e,f);
+      v4sf vr2 = v4_add(v4_mul(wr,re),v4_mul(wi,im));
+      v4sf vi2 = v4_sub(v4_mul(wr,im),v4_mul(wi,re));
+      v4sf x   = v4_add(cr,vr2);
+      v4sf y   = v4_add(ci,vi2);
+      v4_store(ch+t6+1,v4_ziplo(x,y));
+      v4_store(ch+t6+5,v4_ziphi(x,y));
+      x = v4_reverse(v4_sub(cr,vr2));
+      y = v4_reverse(v4_sub(vi2,ci));
+      v4_store(ch+t4-9,v4_ziplo(x,y));
+      v4_store(ch+t4-5,v4_ziphi(x,y));
+      t3+=8;
+      t4-=8;
+      t5+=8;
+      t6+=8;
+    }
+#endif
+    for(;i<ido;i+=2){
       t3+=2;
       t4-=2;
       t5+=2;
@@ -202,7 +235,89 @@ static void dradf4(int ido,int l1,float *cc,float *ch,float *wa1,
     t2=t1;
     t4=t1<<2;
     t5=(t6=ido<<1)+t4;
-    for(i=2;i<ido;i+=2){
+    i=2;
+#ifdef VORBIS_SIMD
+    /* four iterations at a time; same arithmetic as the loop below */
+    for(;i+6<ido;i+=8){
+      v4sf a,b,re,im,wr,wi,cr2,ci2,cr3,ci3,cr4,ci4,vr1,vr2,vr3,vr4;
+      v4sf vi1,vi2,vi3,vi4,x,y;
+      t3=t2+t0;
+
+      a   = v4_load(cc+t3+1);
+      b   = v4_load(cc+t3+5);
+      re  = v4_even(a,b);
+      im  = v4_odd(a,b);
+      a   = v4_load(wa1+i-2);
+      b   = v4_load(wa1+i+2);
+      wr  = v4_even(a,b);
+      wi  = v4_odd(a,b);
+      cr2 = v4_add(v4_mul(wr,re),v4_mul(wi,im));
+      ci2 = v4_sub(v4_mul(wr,im),v4_mul(wi,re));
+      t3+=t0;
+
+      a   = v4_load(cc+t3+1);
+      b   = v4_load(cc+t3+5);
+      re  = v4_even(a,b);
+      im  = v4_odd(a,b);
+      a   = v4_load(wa2+i-2);
+      b   = v4_load(wa2+i+2);
+      wr  = v4_even(a,b);
+      wi  = v4_odd(a,b);
+      cr3 = v4_add(v4_mul(wr,re),v4_mul(wi,im));
+      ci3 = v4_sub(v4_mul(wr,im),v4_mul(wi,re));
+      t3+=t0;
+
+      a   = v4_load(cc+t3+1);
+      b   = v4_load(cc+t3+5);
+      re  = v4_even(a,b);
+      im  = v4_odd(a,b);
+      a   = v4_load(wa3+i-2);
+      b   = v4_load(wa3+i+2);
+      wr  = v4_even(a,b);
+      wi  = v4_odd(a,b);
+      cr4 = v4_add(v4_mul(wr,re),v4_mul(wi,im));
+      ci4 = v4_sub(v4_mul(wr,im),v4_mul(wi,re));
+
+      vr1 = v4_add(cr2,cr4);
+      vr4 = v4_sub(cr4,cr2);
+      vi1 = v4_add(ci2,ci4);
+      vi4 = v4_sub(ci2,ci4);
+
+      a   = v4_load(cc+t2+1);
+      b   = v4_load(cc+t2+5);
+      re  = v4_even(a,b);
+      im  = v4_odd(a,b);
+      vi2 = v4_add(im,ci3);
+      vi3 = v4_sub(im,ci3);
+      vr2 = v4_add(re,cr3);
+      vr3 = v4_sub(re,cr3);
+
+      x = v4_add(vr1,vr2);
+      y = v4_add(vi1,vi2);
+      v4_store(ch+t4+1,v4_ziplo(x,y));
+      v4_store(ch+t4+5,v4_ziphi(x,y));
+
+      x = v4_reverse(v4_sub(vr3,vi4));
+      y = v4_reverse(v4_sub(vr4,vi3));
+      v4_store(ch+t5-9,v4_ziplo(x,y));
+      v4_store(ch+t5-5,v4_ziphi(x,y));
+
+      x = v4_add(vi4,vr3);
+      y = v4_add(vr4,vi3);
+      v4_store(ch+t4+t6+1,v4_ziplo(x,y));
+      v4_store(ch+t4+t6+5,v4_ziphi(x,y));
+
+      x = v4_reverse(v4_sub(vr2,vr1));
+      y = v4_reverse(v4_sub(vi1,vi2));
+      v4_store(ch+t5+t6-9,v4_ziplo(x,y));
+      v4_store(ch+t5+t6-5,v4_ziphi(x,y));
+
+      t2+=8;
+      t4+=8;
+      t5-=8;
+    }
+#endif
+    for(;i<ido;i+=2){
       t3=(t2+=2);
       t4+=2;
       t5-=2;
@@ -1229,19 +1344,25 @@ static void drftb1(int n, float *c, float *ch, float *wa, int *ifac){
   for(i=0;i<n;i++)c[i]=ch[i];
 }
 
+/* the working space lives on the stack rather than in the lookup, so
+   one lookup can serve several transforms at once */
 void drft_forward(drft_lookup *l,float *data){
+  float *ch;
   if(l->n==1)return;
-  drftf1(l->n,data,l->trigcache,l->trigcache+l->n,l->splitcache);
+  ch=alloca(l->n*sizeof(*ch));
+  drftf1(l->n,data,ch,l->trigcache,l->splitcache);
 }
 
 void drft_backward(drft_lookup *l,float *data){
+  float *ch;
   if (l->n==1)return;
-  drftb1(l->n,data,l->trigcache,l->trigcache+l->n,l->splitcache);
+  ch=alloca(l->n*sizeof(*ch));
+  drftb1(l->n,data,ch,l->trigcache,l->splitcache);
 }
 
 void drft_init(drft_lookup *l,int n){
   l->n=n;
-  l->trigcache=_ogg_calloc(3*n,sizeof(*l->trigcache));
+  l->trigcache=_ogg_calloc(n,sizeof(*l->trigcache));
   l->splitcache=_ogg_calloc(32,sizeof(*l->splitcache));
   fdrffti(n, l->trigcache, l->splitcache);
 }
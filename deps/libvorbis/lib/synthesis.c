@@ -182,3 +182,20 @@ int vorbis_synthesis_halfrate_p(vorbis_info *vi){
   codec_setup_info     *ci=vi->codec_setup;
   return ci->halfrate_flag;
 }
+
+int vorbis_synthesis_lowmem(vorbis_info *vi,int flag){
+  /* set / clear low-memory mode: the codebooks are built without the
+     multi-codeword lookup tables, with 16-bit entry indices and, for
+     lattice books, byte indices into the distinct values instead of
+     unpacked float vectors; the MDCTs keep only their scalar twiddles.
+     The output is the same either way.  Only takes effect if set
+     before vorbis_synthesis_init() */
+  codec_setup_info     *ci=vi->codec_setup;
+  ci->lowmem_flag=(flag?1:0);
+  return 0;
+}
+
+int vorbis_synthesis_lowmem_p(vorbis_info *vi){
+  codec_setup_info     *ci=vi->codec_setup;
+  return ci->lowmem_flag;
+}
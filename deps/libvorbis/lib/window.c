@@ -19,6 +19,7 @@
 #include <math.h>
 #include "os.h"
 #include "misc.h"
+#include "simd.h"
 
 static const float vwin64[32] = {
   0.0009460463F, 0.0085006468F, 0.0235352254F, 0.0458950567F,
@@ -2123,10 +2124,21 @@ void _vorbis_apply_window(float *d,int *winno,long *blocksizes,
     for(i=0;i<leftbegin;i++)
       d[i]=0.f;
 
-    for(p=0;i<leftend;i++,p++)
+    p=0;
+#ifdef VORBIS_SIMD
+    for(;i+4<=leftend;i+=4,p+=4)
+      v4_store(d+i,v4_mul(v4_load(d+i),v4_load(windowLW+p)));
+#endif
+    for(;i<leftend;i++,p++)
       d[i]*=windowLW[p];
 
-    for(i=rightbegin,p=rn/2-1;i<rightend;i++,p--)
+    i=rightbegin;
+    p=rn/2-1;
+#ifdef VORBIS_SIMD
+    for(;i+4<=rightend;i+=4,p-=4)
+      v4_store(d+i,v4_mul(v4_load(d+i),v4_reverse(v4_load(windowNW+p-3))));
+#endif
+    for(;i<rightend;i++,p--)
       d[i]*=windowNW[p];
 
     for(;i<n;i++)
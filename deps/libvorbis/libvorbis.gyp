@@ -5,6 +5,7 @@
 #   ./gyp/gyp -f make --depth=. libvorbis.gyp
 #   make
 #   ./out/Debug/test
+#   ./out/Debug/bench
 
 {
   'variables': {
@@ -140,5 +141,13 @@
       'dependencies': [ 'libvorbis' ],
       'sources': [ 'examples/decoder_example.c' ]
     },
+
+    # microbenchmarks for the codec internals
+    {
+      'target_name': 'bench',
+      'type': 'executable',
+      'dependencies': [ 'libvorbis', 'vorbisenc' ],
+      'sources': [ 'bench/bench.c' ]
+    },
   ]
 }
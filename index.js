@@ -11,6 +11,13 @@ var binding = require('./lib/binding');
 
 exports.version = binding.version;
 
+/**
+ * The vector instruction set libvorbis was built with: "sse2", "neon" or
+ * "none".
+ */
+
+exports.simd = binding.simd;
+
 /**
  * Async function that checks if the given `ogg_packet` is Vorbis data. The packet
  * must be the first packet in the ogg stream.
@@ -31,3 +38,17 @@ exports.Decoder = require('./lib/decoder');
  */
 
 exports.Encoder = require('./lib/encoder');
+
+/**
+ * Encodes a whole Buffer of PCM float data on multiple threads, producing the
+ * same kind of `ogg_packet`s as the `Encoder` class.
+ */
+
+exports.encodeParallel = require('./lib/parallel').encodeParallel;
+
+/**
+ * Decodes a whole Ogg Vorbis file held in a Buffer on multiple threads,
+ * producing the same PCM float data as the `Decoder` class.
+ */
+
+exports.decodeParallel = require('./lib/parallel').decodeParallel;
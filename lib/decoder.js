@@ -19,6 +19,19 @@ module.exports = Decoder;
  * The Vorbis `Decoder` class.
  * Accepts `ogg_packet` Buffer instances and outputs PCM audio data.
  *
+ * `vorbis_synthesis()` (everything up to and including the inverse MDCT) runs
+ * on the thread pool, and with the `blocks` option set to more than 1 that
+ * many packets may be in synthesis at once, each in its own `vorbis_block`.
+ * The blocks are always overlapped into the output in packet order. This is
+ * worth it for streams with many channels; the default is 1.
+ *
+ * For when memory per stream matters more than speed, `lowmem: true` builds
+ * smaller decode tables: no multi-codeword lookups, and compact codebook
+ * values. A decoder then needs 10-20% less memory than stock libvorbis (about
+ * half as much as with the default tables) and decodes at about stock
+ * libvorbis speed, some 25% slower than the default. The output is the same. `bitDepth: 16` outputs interleaved 16-bit signed samples instead
+ * of 32-bit floats, rounded and clipped like libvorbisfile's `ov_read()`.
+ *
  * @param {Object} opts
  * @api public
  */
@@ -42,10 +55,26 @@ function Decoder (opts) {
   binding.vorbis_info_init(this.vi);
   binding.vorbis_comment_init(this.vc);
 
+  // number of `vorbis_block`s, i.e. packets that may be in synthesis at once
+  this.blocks = Math.max(1, (opts && opts.blocks) | 0);
+
+  this.lowmem = !!(opts && opts.lowmem);
+  this.bitDepth = (opts && opts.bitDepth == 16) ? 16 : 32;
+
   // the `vorbis_dsp_state` and `vorbis_block` stucts get allocated after the
   // headers have been parsed
   this.vd = null;
   this.vb = null;
+
+  // `vorbis_block`s not currently in use
+  this._free = [];
+
+  // packets in synthesis, in the order they were written
+  this._pending = [];
+
+  // the _transform() or _flush() callback waiting on `_pending`
+  this._waiting = null;
+  this._flushing = false;
 }
 inherits(Decoder, Transform);
 
@@ -65,7 +94,6 @@ Decoder.prototype.packetin = Decoder.prototype.write;
 Decoder.prototype._transform = function (packet, _, cb) {
   debug('_transform()');
 
-  var r;
   var self = this;
   if (this._headerCount > 0) {
     debug('headerin', this._headerCount);
@@ -87,6 +115,10 @@ Decoder.prototype._transform = function (packet, _, cb) {
         this.emit('comments', comments);
 
         var format = binding.get_format(vi);
+        if (this.bitDepth === 16) {
+          format.bitDepth = 16;
+          format.float = false;
+        }
         for (r in format) {
           this[r] = format[r];
         }
@@ -98,46 +130,108 @@ Decoder.prototype._transform = function (packet, _, cb) {
     }.bind(this));
   } else {
     debug('synthesising ogg_packet (packetno %d)', packet.packetno);
-    var vd = this.vd;
-    var vb = this.vb;
-    var channels = this.channels;
-    var eos = !!packet.e_o_s;
-    if (eos) debug('got "eos" packet');
+    var entry = {
+      vb: this._free.pop(),
+      packet: packet,
+      eos: !!packet.e_o_s,
+      done: false,
+      rtn: 0
+    };
+    if (entry.eos) debug('got "eos" packet');
 
-    // TODO: async...
-    r = binding.vorbis_synthesis(vb, packet);
-    if (r !== 0) {
-      return cb(new Error('vorbis_synthesis() failed: ' + r));
-    }
+    // the packet's bytes have to outlive this call now, so take a copy
+    if (this.blocks > 1 && typeof packet.replace === 'function') packet.replace();
 
-    // TODO: async...
-    r = binding.vorbis_synthesis_blockin(vd, vb);
-    if (r !== 0) {
-      return cb(new Error('vorbis_synthesis_blockin() failed: ' + r));
-    }
+    this._pending.push(entry);
+    binding.vorbis_synthesis(entry.vb, packet, function (r) {
+      debug('vorbis_synthesis() return = %d (packetno %d)', r, packet.packetno);
+      entry.done = true;
+      entry.rtn = r;
+      self._blockin();
+    });
 
-    pcmout();
+    if (this._free.length > 0) {
+      // room for another packet
+      cb();
+    } else {
+      this._waiting = cb;
+    }
   }
+};
 
-  function pcmout () {
-    // TODO: async...
-    var b = binding.vorbis_synthesis_pcmout(vd, channels);
-    if (b === 0) {
-      debug('need more "vorbis_block" data...');
-      if (eos) self.push(null); // emit "end"
-      cb();
-    } else if (b < 0) {
-      // some other error...
-      cb(new Error('vorbis_synthesis_pcmout() failed: ' + b));
+/**
+ * Passes the synthesised blocks at the front of the queue to
+ * `vorbis_synthesis_blockin()`, in order, and pushes out the PCM data that
+ * becomes available. A packet that fails is reported as an "error" and
+ * skipped, as it always has been, and decoding goes on with the next one.
+ *
+ * @api private
+ */
+
+Decoder.prototype._blockin = function () {
+  var r, b, err;
+  var self = this;
+  var vd = this.vd;
+  var channels = this.channels;
+  var pending = this._pending;
+  var errors = [];
+
+  while (pending.length > 0 && pending[0].done) {
+    var entry = pending.shift();
+    err = null;
+    if (entry.rtn !== 0) {
+      err = new Error('vorbis_synthesis() failed: ' + entry.rtn);
     } else {
-      debug('got PCM data (%d bytes)', b.length);
+      r = binding.vorbis_synthesis_blockin(vd, entry.vb);
+      if (r !== 0) err = new Error('vorbis_synthesis_blockin() failed: ' + r);
+    }
 
-      self.push(b);
+    // the block is free again either way
+    this._free.push(entry.vb);
+    if (err) {
+      errors.push(err);
+      continue;
+    }
 
-      // try to get more data out
-      pcmout();
+    // TODO: async...
+    while ((b = binding.vorbis_synthesis_pcmout(vd, channels, this.bitDepth)) !== 0) {
+      if (b < 0) {
+        // some other error...
+        errors.push(new Error('vorbis_synthesis_pcmout() failed: ' + b));
+        break;
+      }
+      debug('got PCM data (%d bytes)', b.length);
+      this.push(b);
     }
+    if (entry.eos) this.push(null); // emit "end"
+  }
+
+  // the first error goes to the waiting _transform() callback, if there is
+  // one; an error passed to the _flush() callback would keep "end" from
+  // being emitted, so that one only gets called once nothing is pending
+  var cb = this._waiting;
+  if (cb && (pending.length === 0 || (!this._flushing && (this._free.length > 0 || errors.length > 0)))) {
+    this._waiting = null;
+    err = this._flushing ? null : errors.shift();
+    this._flushing = false;
+    cb(err);
   }
+  errors.forEach(function (e) {
+    self.emit('error', e);
+  });
+};
+
+/**
+ * Waits for the packets still in synthesis once the writable side ends.
+ *
+ * @api private
+ */
+
+Decoder.prototype._flush = function (cb) {
+  debug('_flush(%d packets pending)', this._pending.length);
+  if (this._pending.length === 0) return cb();
+  this._waiting = cb;
+  this._flushing = true;
 };
 
 /**
@@ -151,13 +245,18 @@ Decoder.prototype._transform = function (packet, _, cb) {
 Decoder.prototype._synthesis_init = function () {
   debug('_synthesis_init()');
   this.vd = bufferAlloc(binding.sizeof_vorbis_dsp_state);
-  this.vb = bufferAlloc(binding.sizeof_vorbis_block);
+  if (this.lowmem) binding.vorbis_synthesis_lowmem(this.vi, 1);
   var r = binding.vorbis_synthesis_init(this.vd, this.vi);
   if (r !== 0) {
     return new Error(r);
   }
-  r = binding.vorbis_block_init(this.vd, this.vb);
-  if (r !== 0) {
-    return new Error(r);
+  for (var i = 0; i < this.blocks; i++) {
+    var vb = bufferAlloc(binding.sizeof_vorbis_block);
+    r = binding.vorbis_block_init(this.vd, vb);
+    if (r !== 0) {
+      return new Error(r);
+    }
+    this._free.push(vb);
   }
+  this.vb = this._free[0];
 };
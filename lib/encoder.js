@@ -31,6 +31,12 @@ module.exports = Encoder;
  * You may also specify the "quality" which is a float number from -0.1 to 1.0
  * (low to high quality). If unspecified, the default is 0.6.
  *
+ * The analysis of each block runs on the thread pool, and with the `blocks`
+ * option set to more than 1 that many blocks may be in analysis at once, each
+ * in its own `vorbis_block`. The packets are always output in order, and are
+ * the same as with a single block. This is worth it for streams with many
+ * channels; the default is 1.
+ *
  * @param {Object} opts PCM audio format options
  * @api public
  */
@@ -72,10 +78,29 @@ function Encoder (opts) {
   binding.vorbis_info_init(this.vi);
   binding.vorbis_comment_init(this.vc);
 
+  // number of `vorbis_block`s, i.e. blocks that may be in analysis at once
+  this.blocks = Math.max(1, opts.blocks | 0);
+
   // the `vorbis_dsp_state` and `vorbis_block` stucts get allocated when the
   // initial 3 header packets are being written
   this.vd = null;
   this.vb = null;
+
+  // `vorbis_block`s not currently in use
+  this._free = [];
+
+  // blocks in analysis, in the order they were blocked out
+  this._pending = [];
+
+  // set while `vorbis_bitrate_flushpacket()` is being called for a block
+  this._flushingPackets = false;
+
+  // an analysis error that stops the encoder
+  this._error = null;
+
+  // the _blockout() or _flush() callback waiting on `_pending`
+  this._waiting = null;
+  this._flushing = false;
 }
 inherits(Encoder, Transform);
 
@@ -149,13 +174,17 @@ Encoder.prototype._writeHeader = function (cb) {
 
   // synthesis init
   this.vd = bufferAlloc(binding.sizeof_vorbis_dsp_state);
-  this.vb = bufferAlloc(binding.sizeof_vorbis_block);
   r = binding.vorbis_analysis_init(this.vd, this.vi);
   debug('vorbis_analysis_init() return = %d', r);
   if (r !== 0) return cb(new Error(r));
-  r = binding.vorbis_block_init(this.vd, this.vb);
-  debug('vorbis_block_init() return = %d', r);
-  if (r !== 0) return cb(new Error(r));
+  for (var i = 0; i < this.blocks; i++) {
+    var vb = bufferAlloc(binding.sizeof_vorbis_block);
+    r = binding.vorbis_block_init(this.vd, vb);
+    debug('vorbis_block_init() return = %d', r);
+    if (r !== 0) return cb(new Error(r));
+    this._free.push(vb);
+  }
+  this.vb = this._free[0];
 
   // create the first 3 header packets
   // TODO: async
@@ -222,43 +251,160 @@ Encoder.prototype._writepcm = function (buf, cb) {
 
 /**
  * Calls `vorbis_analysis_blockout()` continuously until no more blocks are
- * returned. For each "block" that gets returned, _flushpacket() is called to
- * extract any possible `OGGPacket` instances from the block.
+ * returned. Each "block" that gets returned is handed to _analysis(); when
+ * all of the `vorbis_block`s are in use, this waits for one to be freed up.
  *
  * @api private
  */
 
 Encoder.prototype._blockout = function (cb) {
   debug('_blockout');
-  var vd = this.vd;
-  var vb = this.vb;
+  if (this._error) return cb(this._error);
   var self = this;
-  binding.vorbis_analysis_blockout(vd, vb, function (rtn) {
+  var vb = this._free.pop();
+  if (!vb) {
+    // every block is in analysis, carry on once one has been output
+    this._waiting = function (err) {
+      if (err) return cb(err);
+      self._blockout(cb);
+    };
+    return;
+  }
+  binding.vorbis_analysis_blockout(this.vd, vb, function (rtn) {
     debug('vorbis_analysis_blockout() return = %d', rtn);
     if (rtn === 1) {
-      // got a "block"
+      // got a "block", now attempt to read another one
+      self._analysis(vb);
+      self._blockout(cb);
+    } else {
+      self._free.push(vb);
+      if (rtn === 0) {
+        // need more PCM data...
+        cb();
+      } else {
+        // error code
+        cb(new Error('vorbis_analysis_blockout() error: ' + rtn));
+      }
+    }
+  });
+};
 
-      // analysis, assume we want to use bitrate management
-      // TODO: async?
-      // TODO: check return values
-      binding.vorbis_analysis(vb, null);
-      // console.error('vorbis_analysis() = %d', r);
-      binding.vorbis_bitrate_addblock(vb);
-      // console.error('vorbis_bitrate_addblock() = %d', r);
+/**
+ * Runs the analysis of block `vb` on the thread pool: first
+ * `vorbis_analysis_transform()`, then `vorbis_analysis_ampmax()` (in block
+ * order), then `vorbis_analysis()`. Several blocks may be in any of the
+ * threaded steps at once.
+ *
+ * @api private
+ */
 
-      self._flushpacket(afterFlush);
-    } else if (rtn === 0) {
-      // need more PCM data...
-      cb();
-    } else {
-      // error code
-      cb(new Error('vorbis_analysis_blockout() error: ' + rtn));
+Encoder.prototype._analysis = function (vb) {
+  var self = this;
+  var entry = {
+    vb: vb,
+    transformed: false,
+    analysis: false,
+    done: false,
+    err: null
+  };
+  this._pending.push(entry);
+
+  binding.vorbis_analysis_transform(vb, function (rtn) {
+    debug('vorbis_analysis_transform() return = %d', rtn);
+    entry.transformed = true;
+    if (rtn !== 0) {
+      entry.done = true;
+      entry.err = new Error('vorbis_analysis_transform() error: ' + rtn);
+      return self._packetout();
     }
+    self._ampmax();
   });
-  function afterFlush (err) {
-    if (err) return cb(err);
-    // now attempt to read another "block"
-    self._blockout(cb);
+};
+
+/**
+ * Calls `vorbis_analysis_ampmax()` for the transformed blocks at the front of
+ * the queue that haven't had it yet, and starts their `vorbis_analysis()`.
+ *
+ * @api private
+ */
+
+Encoder.prototype._ampmax = function () {
+  var self = this;
+  var pending = this._pending;
+  for (var i = 0; i < pending.length && pending[i].transformed; i++) {
+    var entry = pending[i];
+    if (entry.analysis || entry.done) continue;
+    entry.analysis = true;
+    binding.vorbis_analysis_ampmax(entry.vb);
+    analysis(entry);
+  }
+
+  function analysis (entry) {
+    // analysis, assume we want to use bitrate management
+    binding.vorbis_analysis(entry.vb, null, function (rtn) {
+      debug('vorbis_analysis() return = %d', rtn);
+      entry.done = true;
+      if (rtn !== 0) entry.err = new Error('vorbis_analysis() error: ' + rtn);
+      self._packetout();
+    });
+  }
+};
+
+/**
+ * Passes the analysed blocks at the front of the queue to
+ * `vorbis_bitrate_addblock()`, in order, and outputs their packets.
+ *
+ * @api private
+ */
+
+Encoder.prototype._packetout = function () {
+  // called again once the packets have been flushed
+  if (this._flushingPackets || this._error) return;
+
+  var self = this;
+  var pending = this._pending;
+  var err, r;
+  if (pending.length > 0 && pending[0].done) {
+    var entry = pending.shift();
+    err = entry.err;
+    if (!err) {
+      // TODO: async?
+      r = binding.vorbis_bitrate_addblock(entry.vb);
+      debug('vorbis_bitrate_addblock() return = %d', r);
+      if (r !== 0) err = new Error('vorbis_bitrate_addblock() error: ' + r);
+    }
+    if (!err) {
+      this._flushingPackets = true;
+      this._flushpacket(function (err) {
+        self._flushingPackets = false;
+        self._free.push(entry.vb);
+        if (err) return self._wake(err);
+        self._packetout();
+      });
+      return;
+    }
+  }
+  this._wake(err);
+};
+
+/**
+ * Calls the waiting _blockout() or _flush() callback, once it can continue.
+ * An error stops any further output; it goes to the waiting callback, or else
+ * to the next _blockout() call.
+ *
+ * @api private
+ */
+
+Encoder.prototype._wake = function (err) {
+  if (err) {
+    this._error = err;
+    this._pending.length = 0;
+  }
+  var cb = this._waiting;
+  if (cb && (err || (this._free.length > 0 && !this._flushing) || this._pending.length === 0)) {
+    this._waiting = null;
+    this._flushing = false;
+    cb(err);
   }
 };
 
@@ -305,23 +451,34 @@ Encoder.prototype._flushpacket = function (cb) {
 
 Encoder.prototype._flush = function (cb) {
   debug('_onflush()');
+  var self = this;
 
   // ensure the vorbis header has been output first
   if (this._headerWritten) {
-    process.call(this);
+    process();
   } else {
     this._writeHeader(process);
   }
 
-  function process () {
-    var r = binding.vorbis_analysis_eos(this.vd, 0);
+  function process (err) {
+    if (err) return cb(err);
+    var r = binding.vorbis_analysis_eos(self.vd, 0);
     if (r === 0) {
-      this._blockout(cb);
+      self._blockout(drain);
     } else {
       // error code
       cb(new Error('vorbis_analysis_eos() error: ' + r));
     }
   }
+
+  // wait for the blocks still in analysis
+  function drain (err) {
+    if (err) return cb(err);
+    debug('_flush(%d blocks pending)', self._pending.length);
+    if (self._pending.length === 0) return cb();
+    self._waiting = cb;
+    self._flushing = true;
+  }
 };
 
 /**
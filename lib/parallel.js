@@ -0,0 +1,140 @@
+
+/**
+ * Module dependencies.
+ */
+
+var os = require('os');
+var binding = require('./binding');
+var OGGPacket = require('ogg').ogg_packet;
+var debug = require('debug')('vorbis:parallel');
+var bufferAlloc = require('buffer-alloc');
+
+function noop (_) {}
+
+/**
+ * Encodes a complete Buffer of PCM audio into Vorbis `OGGPacket`s using
+ * multiple threads.
+ *
+ * The input is split into one segment per thread (short inputs use fewer
+ * threads) and each segment is encoded by its own libvorbis encoder, started
+ * a little before the segment so that it has settled by the time its audio
+ * begins. The packets are then spliced back together at block
+ * boundaries where the neighbouring encoders agree, giving one ordinary
+ * logical stream with the usual granulepos values. The packets can be written
+ * to an `ogg.Encoder` stream just like the output of `vorbis.Encoder`.
+ *
+ * Input must be interleaved 32-bit float samples in native endianness.
+ * Options are `channels` (default 2), `sampleRate` (default 44100),
+ * `quality` (-0.1...1.0, default 0.6) and `threads` (defaults to the number
+ * of CPUs).
+ *
+ * @param {Buffer} pcm PCM audio data
+ * @param {Object} opts encoding options
+ * @param {Function} fn callback function `(err, packets)`
+ * @api public
+ */
+
+exports.encodeParallel = function (pcm, opts, fn) {
+  if (typeof opts === 'function') {
+    fn = opts;
+    opts = null;
+  }
+  if (!opts) opts = {};
+
+  var channels = (opts.channels == null) ? 2 : opts.channels | 0;
+  var sampleRate = (opts.sampleRate == null) ? 44100 : opts.sampleRate | 0;
+  var quality = (opts.quality == null) ? 0.6 : +opts.quality;
+  var threads = (opts.threads == null) ? os.cpus().length : opts.threads | 0;
+  if (quality < -0.1 || quality > 1.0) {
+    throw new Error('"quality" must be in the range -0.1...1.0, got ' + quality);
+  }
+  if (threads < 1) threads = 1;
+
+  var blockAlign = 4 * channels;
+  var samples = pcm.length / blockAlign | 0;
+  if (samples * blockAlign !== pcm.length) {
+    throw new Error('PCM buffer length must be a multiple of ' + blockAlign + ' bytes, got ' + pcm.length);
+  }
+
+  debug('encodeParallel(%d samples, %d threads)', samples, threads);
+  binding.encode_parallel(pcm, channels, sampleRate, quality, samples, threads, function (rtn, list, count, joints) {
+    debug('encode_parallel() return = %d', rtn);
+
+    noop(pcm); // keep ref to "pcm" for the async call...
+
+    if (rtn !== 0) {
+      // error code
+      return fn(new Error('encode_parallel() error: ' + rtn));
+    }
+    debug('%d packets, %d segment joints', count, joints);
+
+    var packets = new Array(count);
+    for (var i = 0; i < count; i++) {
+      var packet = new OGGPacket();
+      binding.packet_list_get(list, i, packet);
+
+      // copy the bytes out of the native packet list
+      packet.replace();
+
+      if (i === 2) {
+        // specify that a page flush() call is required after the 3rd packet
+        packet.flush = true;
+      } else if (i > 2) {
+        // the consumer should call `pageout()` after each audio packet
+        packet.pageout = true;
+      }
+      packets[i] = packet;
+    }
+    fn(null, packets);
+  });
+};
+
+/**
+ * Decodes the first Vorbis stream of a complete Ogg file held in a Buffer,
+ * using multiple threads.
+ *
+ * The stream's audio pages are split into one page range per thread. Each
+ * range is decoded on its own, starting with the last packet of the page
+ * before it to prime the overlap, and the outputs are joined back together.
+ * The PCM data is exactly what the `Decoder` class would output for the
+ * same stream.
+ *
+ * The callback gets the interleaved 32-bit float PCM data, the PCM `format`
+ * (as emitted by `Decoder`'s "format" event) and the `comments` array.
+ * The only option is `threads` (defaults to the number of CPUs).
+ *
+ * @param {Buffer} data Ogg file contents
+ * @param {Object} opts decoding options
+ * @param {Function} fn callback function `(err, pcm, format, comments)`
+ * @api public
+ */
+
+exports.decodeParallel = function (data, opts, fn) {
+  if (typeof opts === 'function') {
+    fn = opts;
+    opts = null;
+  }
+  if (!opts) opts = {};
+
+  var threads = (opts.threads == null) ? os.cpus().length : opts.threads | 0;
+  if (threads < 1) threads = 1;
+
+  var vi = bufferAlloc(binding.sizeof_vorbis_info);
+  var vc = bufferAlloc(binding.sizeof_vorbis_comment);
+  binding.vorbis_info_init(vi);
+  binding.vorbis_comment_init(vc);
+
+  debug('decodeParallel(%d bytes, %d threads)', data.length, threads);
+  binding.decode_parallel(data, vi, vc, threads, function (rtn, pcm) {
+    debug('decode_parallel() return = %d', rtn);
+
+    noop(data); // keep ref to "data" for the async call...
+
+    if (rtn !== 0) {
+      // error code
+      return fn(new Error('decode_parallel() error: ' + rtn));
+    }
+
+    fn(null, pcm || bufferAlloc(0), binding.get_format(vi), binding.comment_array(vc));
+  });
+};
@@ -23,18 +23,90 @@
 #include <node.h>
 #include <nan.h>
 #include <string.h>
+#include <math.h>
 
 #include "node_buffer.h"
 #include "node_pointer.h"
+#include "parallel.h"
 #include "ogg/ogg.h"
 #include "vorbis/codec.h"
 #include "vorbis/vorbisenc.h"
 
+/* The vector code libvorbis' hot loops were compiled with. This is the test
+ * deps/libvorbis/lib/simd.h makes, and the two are built with the same
+ * flags; there is no choice made at run time. */
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_STRING "sse2"
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SIMD_STRING "neon"
+#else
+#define SIMD_STRING "none"
+#endif
+
 using namespace v8;
 using namespace node;
 
 namespace nodevorbis {
 
+/* The async functions below queue their work with QueueWorker(), which is
+ * Nan::AsyncQueueWorker() plus a count of how long each job waited for a
+ * thread pool thread; node_threadpool_stats() reports it. */
+
+class QueuedWorker : public Nan::AsyncWorker {
+ public:
+  explicit QueuedWorker(Nan::Callback *callback)
+    : Nan::AsyncWorker(callback), queued(0), waited(0) { }
+  uint64_t queued;
+  uint64_t waited;
+};
+
+static uint64_t queue_pending = 0;
+static uint64_t queue_works = 0;
+static uint64_t queue_wait = 0;
+static uint64_t queue_max_wait = 0;
+
+static void QueuedExecute (uv_work_t *req) {
+  QueuedWorker *worker = static_cast<QueuedWorker *>(static_cast<Nan::AsyncWorker *>(req->data));
+  worker->waited = uv_hrtime() - worker->queued;
+  worker->Execute();
+}
+
+static void QueuedExecuteComplete (uv_work_t *req, int status) {
+  QueuedWorker *worker = static_cast<QueuedWorker *>(static_cast<Nan::AsyncWorker *>(req->data));
+
+  /* back on the loop thread, so the totals need no locking */
+  queue_pending--;
+  queue_works++;
+  queue_wait += worker->waited;
+  if (worker->waited > queue_max_wait) queue_max_wait = worker->waited;
+
+  worker->WorkComplete();
+  worker->Destroy();
+}
+
+static void QueueWorker (QueuedWorker *worker) {
+  queue_pending++;
+  worker->queued = uv_hrtime();
+  uv_queue_work(Nan::GetCurrentEventLoop(), &worker->request, QueuedExecute, QueuedExecuteComplete);
+}
+
+/* the jobs run so far and those still pending, the total time the run ones
+ * waited for a thread and the longest wait, in milliseconds. Passing `true`
+ * starts the longest wait over after reading it */
+NAN_METHOD(node_threadpool_stats) {
+  Nan::HandleScope scope;
+
+  v8::Local<Object> stats = Nan::New<Object>();
+  Nan::Set(stats, Nan::New<String>("works").ToLocalChecked(), Nan::New<Number>(static_cast<double>(queue_works)));
+  Nan::Set(stats, Nan::New<String>("pending").ToLocalChecked(), Nan::New<Number>(static_cast<double>(queue_pending)));
+  Nan::Set(stats, Nan::New<String>("waitMs").ToLocalChecked(), Nan::New<Number>(queue_wait / 1e6));
+  Nan::Set(stats, Nan::New<String>("maxWaitMs").ToLocalChecked(), Nan::New<Number>(queue_max_wait / 1e6));
+  if (info[0]->IsTrue()) queue_max_wait = 0;
+
+  info.GetReturnValue().Set(stats);
+}
+
 
 NAN_METHOD(node_vorbis_info_init) {
   Nan::HandleScope scope;
@@ -59,6 +131,15 @@ NAN_METHOD(node_vorbis_synthesis_init) {
 }
 
 
+NAN_METHOD(node_vorbis_synthesis_lowmem) {
+  Nan::HandleScope scope;
+  vorbis_info *vi = UnwrapPointer<vorbis_info *>(info[0]);
+  int flag = info[1]->Int32Value();
+  int r = vorbis_synthesis_lowmem(vi, flag);
+  info.GetReturnValue().Set(Nan::New<Integer>(r));
+}
+
+
 NAN_METHOD(node_vorbis_analysis_init) {
   Nan::HandleScope scope;
   vorbis_dsp_state *vd = UnwrapPointer<vorbis_dsp_state *>(info[0]);
@@ -140,10 +221,10 @@ NAN_METHOD(node_vorbis_analysis_headerout) {
 /* combination of `vorbis_analysis_buffer()`, `memcpy()`, and
  * `vorbis_analysis_wrote()` on the thread pool. */
 
-class AnalysisWriteWorker : public Nan::AsyncWorker {
+class AnalysisWriteWorker : public QueuedWorker {
  public:
   AnalysisWriteWorker(vorbis_dsp_state *vd, float *buffer, int channels, long samples, Nan::Callback *callback)
-    : Nan::AsyncWorker(callback), vd(vd), buffer(buffer), channels(channels), samples(samples), rtn(0) { }
+    : QueuedWorker(callback), vd(vd), buffer(buffer), channels(channels), samples(samples), rtn(0) { }
   ~AnalysisWriteWorker() { }
   void Execute () {
     /* input samples are interleaved floats */
@@ -186,14 +267,14 @@ NAN_METHOD(node_vorbis_analysis_write) {
   long samples = info[3]->NumberValue();
   Nan::Callback *callback = new Nan::Callback(info[4].As<Function>());
 
-  Nan::AsyncQueueWorker(new AnalysisWriteWorker(vd, buffer, channels, samples, callback));
+  QueueWorker(new AnalysisWriteWorker(vd, buffer, channels, samples, callback));
 }
 
 /* vorbis_analysis_blockout() on the thread pool */
-class AnalysisBlockoutWorker : public Nan::AsyncWorker {
+class AnalysisBlockoutWorker : public QueuedWorker {
  public:
   AnalysisBlockoutWorker(vorbis_dsp_state *vd, vorbis_block *vb, Nan::Callback *callback)
-    : Nan::AsyncWorker(callback), vd(vd), vb(vb), rtn(0) { }
+    : QueuedWorker(callback), vd(vd), vb(vb), rtn(0) { }
   ~AnalysisBlockoutWorker() { }
   void Execute () {
     rtn = vorbis_analysis_blockout(vd, vb);
@@ -218,7 +299,7 @@ NAN_METHOD(node_vorbis_analysis_blockout) {
   vorbis_block *vb = UnwrapPointer<vorbis_block *>(info[1]);
   Nan::Callback *callback = new Nan::Callback(info[2].As<Function>());
 
-  Nan::AsyncQueueWorker(new AnalysisBlockoutWorker(vd, vb, callback));
+  QueueWorker(new AnalysisBlockoutWorker(vd, vb, callback));
 }
 
 /* TODO: async? */
@@ -230,14 +311,78 @@ NAN_METHOD(node_vorbis_analysis_eos) {
   info.GetReturnValue().Set(Nan::New<Integer>(i));
 }
 
-/* TODO: async? */
+/* vorbis_analysis_transform() on the thread pool. It only writes to the
+ * `vorbis_block`, so several of these may run at once on different blocks
+ * of the same `vorbis_dsp_state` */
+class AnalysisTransformWorker : public QueuedWorker {
+ public:
+  AnalysisTransformWorker(vorbis_block *vb, Nan::Callback *callback)
+    : QueuedWorker(callback), vb(vb), rtn(0) { }
+  ~AnalysisTransformWorker() { }
+  void Execute () {
+    rtn = vorbis_analysis_transform(vb);
+  }
+  void HandleOKCallback () {
+    Nan::HandleScope scope;
+
+    v8::Local<Value> argv[1] = { Nan::New<Integer>(rtn) };
+
+    callback->Call(1, argv, async_resource);
+  }
+ private:
+  vorbis_block *vb;
+  int rtn;
+};
+
+NAN_METHOD(node_vorbis_analysis_transform) {
+  Nan::HandleScope scope;
+
+  vorbis_block *vb = UnwrapPointer<vorbis_block *>(info[0]);
+  Nan::Callback *callback = new Nan::Callback(info[1].As<Function>());
+
+  QueueWorker(new AnalysisTransformWorker(vb, callback));
+}
+
+/* cheap, and must be called in block order */
+NAN_METHOD(node_vorbis_analysis_ampmax) {
+  Nan::HandleScope scope;
+  vorbis_block *vb = UnwrapPointer<vorbis_block *>(info[0]);
+
+  int i = vorbis_analysis_ampmax(vb);
+  info.GetReturnValue().Set(Nan::New<Integer>(i));
+}
+
+/* vorbis_analysis() on the thread pool; like vorbis_analysis_transform(),
+ * it may run on several blocks at once */
+class AnalysisWorker : public QueuedWorker {
+ public:
+  AnalysisWorker(vorbis_block *vb, ogg_packet *op, Nan::Callback *callback)
+    : QueuedWorker(callback), vb(vb), op(op), rtn(0) { }
+  ~AnalysisWorker() { }
+  void Execute () {
+    rtn = vorbis_analysis(vb, op);
+  }
+  void HandleOKCallback () {
+    Nan::HandleScope scope;
+
+    v8::Local<Value> argv[1] = { Nan::New<Integer>(rtn) };
+
+    callback->Call(1, argv, async_resource);
+  }
+ private:
+  vorbis_block *vb;
+  ogg_packet *op;
+  int rtn;
+};
+
 NAN_METHOD(node_vorbis_analysis) {
   Nan::HandleScope scope;
+
   vorbis_block *vb = UnwrapPointer<vorbis_block *>(info[0]);
   ogg_packet *op = UnwrapPointer<ogg_packet *>(info[1]);
+  Nan::Callback *callback = new Nan::Callback(info[2].As<Function>());
 
-  int i = vorbis_analysis(vb, op);
-  info.GetReturnValue().Set(Nan::New<Integer>(i));
+  QueueWorker(new AnalysisWorker(vb, op, callback));
 }
 
 /* TODO: async? */
@@ -251,10 +396,10 @@ NAN_METHOD(node_vorbis_bitrate_addblock) {
 
 
 /* vorbis_bitrate_flushpacket() on the thread pool */
-class BitrateFlushpacketWorker : public Nan::AsyncWorker {
+class BitrateFlushpacketWorker : public QueuedWorker {
  public:
   BitrateFlushpacketWorker(vorbis_dsp_state *vd, ogg_packet *op, Nan::Callback *callback)
-    : Nan::AsyncWorker(callback), vd(vd), op(op), rtn(0) { }
+    : QueuedWorker(callback), vd(vd), op(op), rtn(0) { }
   ~BitrateFlushpacketWorker() { }
   void Execute () {
     rtn = vorbis_bitrate_flushpacket(vd, op);
@@ -279,15 +424,15 @@ NAN_METHOD(node_vorbis_bitrate_flushpacket) {
   ogg_packet *op = UnwrapPointer<ogg_packet *>(info[1]);
   Nan::Callback *callback = new Nan::Callback(info[2].As<Function>());
 
-  Nan::AsyncQueueWorker(new BitrateFlushpacketWorker(vd, op, callback));
+  QueueWorker(new BitrateFlushpacketWorker(vd, op, callback));
 }
 
 
 /* vorbis_synthesis_idheader() called on the thread pool */
-class SynthesisIdheaderWorker : public Nan::AsyncWorker {
+class SynthesisIdheaderWorker : public QueuedWorker {
  public:
   SynthesisIdheaderWorker(ogg_packet *op, Nan::Callback *callback)
-    : Nan::AsyncWorker(callback), op(op), rtn(0) { }
+    : QueuedWorker(callback), op(op), rtn(0) { }
   ~SynthesisIdheaderWorker() { }
   void Execute () {
     rtn = vorbis_synthesis_idheader(op);
@@ -310,15 +455,15 @@ NAN_METHOD(node_vorbis_synthesis_idheader) {
   ogg_packet *op = UnwrapPointer<ogg_packet *>(info[0]);
   Nan::Callback *callback = new Nan::Callback(info[1].As<Function>());
 
-  Nan::AsyncQueueWorker(new SynthesisIdheaderWorker(op, callback));
+  QueueWorker(new SynthesisIdheaderWorker(op, callback));
 }
 
 
 /* vorbis_synthesis_headerin() called on the thread pool */
-class SynthesisHeaderinWorker : public Nan::AsyncWorker {
+class SynthesisHeaderinWorker : public QueuedWorker {
  public:
   SynthesisHeaderinWorker(vorbis_info *vi, vorbis_comment *vc, ogg_packet *op, Nan::Callback *callback)
-    : Nan::AsyncWorker(callback), vi(vi), vc(vc), op(op), rtn(0) { }
+    : QueuedWorker(callback), vi(vi), vc(vc), op(op), rtn(0) { }
   ~SynthesisHeaderinWorker() { }
   void Execute () {
       rtn = vorbis_synthesis_headerin(vi, vc, op);
@@ -344,19 +489,43 @@ NAN_METHOD(node_vorbis_synthesis_headerin) {
   ogg_packet *op = UnwrapPointer<ogg_packet *>(info[2]);
   Nan::Callback *callback = new Nan::Callback(info[3].As<Function>());
 
-  Nan::AsyncQueueWorker(new SynthesisHeaderinWorker(vi, vc, op, callback));
+  QueueWorker(new SynthesisHeaderinWorker(vi, vc, op, callback));
 }
 
 
 
-/* TODO: async */
+/* vorbis_synthesis() on the thread pool. It only reads the shared decoder
+ * setup, so several of these may run at once on different `vorbis_block`s
+ * of the same `vorbis_dsp_state` */
+class SynthesisWorker : public QueuedWorker {
+ public:
+  SynthesisWorker(vorbis_block *vb, ogg_packet *op, Nan::Callback *callback)
+    : QueuedWorker(callback), vb(vb), op(op), rtn(0) { }
+  ~SynthesisWorker() { }
+  void Execute () {
+    rtn = vorbis_synthesis(vb, op);
+  }
+  void HandleOKCallback () {
+    Nan::HandleScope scope;
+
+    v8::Local<Value> argv[1] = { Nan::New<Integer>(rtn) };
+
+    callback->Call(1, argv, async_resource);
+  }
+ private:
+  vorbis_block *vb;
+  ogg_packet *op;
+  int rtn;
+};
+
 NAN_METHOD(node_vorbis_synthesis) {
   Nan::HandleScope scope;
+
   vorbis_block *vb = UnwrapPointer<vorbis_block *>(info[0]);
   ogg_packet *op = UnwrapPointer<ogg_packet *>(info[1]);
+  Nan::Callback *callback = new Nan::Callback(info[2].As<Function>());
 
-  int i = vorbis_synthesis(vb, op);
-  info.GetReturnValue().Set(Nan::New<Integer>(i));
+  QueueWorker(new SynthesisWorker(vb, op, callback));
 }
 
 
@@ -379,10 +548,29 @@ NAN_METHOD(node_vorbis_synthesis_pcmout) {
   v8::Local<Value> rtn;
   vorbis_dsp_state *vd = UnwrapPointer<vorbis_dsp_state *>(info[0]);
   int channels = info[1]->Int32Value();
+  int bitDepth = info[2]->IsUndefined() ? 32 : info[2]->Int32Value();
 
   samples = vorbis_synthesis_pcmout(vd, &pcm);
 
-  if (samples > 0) {
+  if (samples > 0 && bitDepth == 16) {
+    /* interlaced 16-bit signed, rounded and clipped like ov_read() does */
+    Nan::MaybeLocal<Object> buffer = Nan::NewBuffer(samples * channels * sizeof(int16_t));
+    int16_t *buf = reinterpret_cast<int16_t *>(Buffer::Data(buffer.ToLocalChecked()));
+    int i, j;
+    for (i = 0; i < channels; i++) {
+      int16_t *ptr = buf + i;
+      float *mono = pcm[i];
+      for (j = 0; j < samples; j++) {
+        long val = lrintf(mono[j] * 32768.f);
+        if (val > 32767) val = 32767;
+        if (val < -32768) val = -32768;
+        *ptr = static_cast<int16_t>(val);
+        ptr += channels;
+      }
+    }
+    vorbis_synthesis_read(vd, samples);
+    rtn = buffer.ToLocalChecked();
+  } else if (samples > 0) {
     /* we need to interlace the pcm float data... */
     Nan::MaybeLocal<Object> buffer = Nan::NewBuffer(samples * channels * sizeof(float));
     float *buf = reinterpret_cast<float *>(Buffer::Data(buffer.ToLocalChecked()));
@@ -406,6 +594,152 @@ NAN_METHOD(node_vorbis_synthesis_pcmout) {
 }
 
 
+/* encode_parallel() on the thread pool. The packets are handed back to JS
+ * as an opaque "packet list" handle, read out with `packet_list_get()` */
+
+static void free_packet_list(char *data, void *hint) {
+  delete reinterpret_cast<PacketList *>(data);
+}
+
+class EncodeParallelWorker : public QueuedWorker {
+ public:
+  EncodeParallelWorker(float *buffer, int channels, long rate, float quality, long samples, int segments, Nan::Callback *callback)
+    : QueuedWorker(callback), buffer(buffer), channels(channels), rate(rate), quality(quality), samples(samples), segments(segments), list(NULL), joints(0), rtn(0) { }
+  ~EncodeParallelWorker() {
+    delete list;
+  }
+  void Execute () {
+    list = new PacketList();
+    rtn = encode_parallel(buffer, channels, rate, quality, samples, segments, *list, &joints);
+  }
+  void HandleOKCallback () {
+    Nan::HandleScope scope;
+
+    if (rtn != 0) {
+      v8::Local<Value> argv[1] = { Nan::New<Integer>(rtn) };
+      callback->Call(1, argv, async_resource);
+      return;
+    }
+
+    /* the Buffer owns the list from here on */
+    uint32_t count = static_cast<uint32_t>(list->size());
+    v8::Local<Value> handle = Nan::NewBuffer(reinterpret_cast<char *>(list), sizeof(PacketList), free_packet_list, NULL).ToLocalChecked();
+    list = NULL;
+
+    v8::Local<Value> argv[4] = { Nan::New<Integer>(rtn), handle, Nan::New<Integer>(count), Nan::New<Integer>(joints) };
+
+    callback->Call(4, argv, async_resource);
+  }
+ private:
+  float *buffer;
+  int channels;
+  long rate;
+  float quality;
+  long samples;
+  int segments;
+  PacketList *list;
+  int joints;
+  int rtn;
+};
+
+NAN_METHOD(node_encode_parallel) {
+  Nan::HandleScope scope;
+
+  float *buffer = UnwrapPointer<float *>(info[0]);
+  int channels = info[1]->IntegerValue();
+  long rate = info[2]->IntegerValue();
+  float quality = info[3]->NumberValue();
+  long samples = info[4]->NumberValue();
+  int segments = info[5]->IntegerValue();
+  Nan::Callback *callback = new Nan::Callback(info[6].As<Function>());
+
+  QueueWorker(new EncodeParallelWorker(buffer, channels, rate, quality, samples, segments, callback));
+}
+
+
+/* points the given `ogg_packet` at packet number `index` of a packet list.
+ * The bytes still belong to the list, so call `replace()` on it afterwards */
+NAN_METHOD(node_packet_list_get) {
+  Nan::HandleScope scope;
+  PacketList *list = UnwrapPointer<PacketList *>(info[0]);
+  uint32_t index = info[1]->Uint32Value();
+  ogg_packet *op = UnwrapPointer<ogg_packet *>(info[2]);
+
+  if (list == NULL || op == NULL || index >= list->size()) {
+    info.GetReturnValue().Set(Nan::New<Integer>(OV_EINVAL));
+    return;
+  }
+
+  OwnedPacket &p = (*list)[index];
+  op->packet = p.data.empty() ? NULL : &p.data[0];
+  op->bytes = static_cast<long>(p.data.size());
+  op->b_o_s = (index == 0);
+  op->e_o_s = p.eos;
+  op->granulepos = p.granulepos;
+  op->packetno = index;
+  info.GetReturnValue().Set(Nan::New<Integer>(0));
+}
+
+
+/* decode_parallel() on the thread pool. The PCM vector is handed over to
+ * the resulting Buffer as-is */
+
+static void free_pcm_vector(char *data, void *hint) {
+  delete reinterpret_cast<std::vector<float> *>(hint);
+}
+
+class DecodeParallelWorker : public QueuedWorker {
+ public:
+  DecodeParallelWorker(unsigned char *data, size_t length, vorbis_info *vi, vorbis_comment *vc, int segments, Nan::Callback *callback)
+    : QueuedWorker(callback), data(data), length(length), vi(vi), vc(vc), segments(segments), pcm(NULL), rtn(0) { }
+  ~DecodeParallelWorker() {
+    delete pcm;
+  }
+  void Execute () {
+    pcm = new std::vector<float>();
+    rtn = decode_parallel(data, length, vi, vc, segments, *pcm);
+  }
+  void HandleOKCallback () {
+    Nan::HandleScope scope;
+
+    if (rtn != 0 || pcm->empty()) {
+      v8::Local<Value> argv[1] = { Nan::New<Integer>(rtn) };
+      callback->Call(1, argv, async_resource);
+      return;
+    }
+
+    /* the Buffer owns the samples from here on */
+    v8::Local<Value> buffer = Nan::NewBuffer(reinterpret_cast<char *>(&(*pcm)[0]), pcm->size() * sizeof(float), free_pcm_vector, pcm).ToLocalChecked();
+    pcm = NULL;
+
+    v8::Local<Value> argv[2] = { Nan::New<Integer>(rtn), buffer };
+
+    callback->Call(2, argv, async_resource);
+  }
+ private:
+  unsigned char *data;
+  size_t length;
+  vorbis_info *vi;
+  vorbis_comment *vc;
+  int segments;
+  std::vector<float> *pcm;
+  int rtn;
+};
+
+NAN_METHOD(node_decode_parallel) {
+  Nan::HandleScope scope;
+
+  unsigned char *data = UnwrapPointer<unsigned char *>(info[0]);
+  size_t length = Buffer::Length(info[0]);
+  vorbis_info *vi = UnwrapPointer<vorbis_info *>(info[1]);
+  vorbis_comment *vc = UnwrapPointer<vorbis_comment *>(info[2]);
+  int segments = info[3]->IntegerValue();
+  Nan::Callback *callback = new Nan::Callback(info[4].As<Function>());
+
+  QueueWorker(new DecodeParallelWorker(data, length, vi, vc, segments, callback));
+}
+
+
 NAN_MODULE_INIT(Initialize) {
   Nan::HandleScope scope;
 
@@ -443,6 +777,7 @@ NAN_MODULE_INIT(Initialize) {
   Nan::SetMethod(target, "vorbis_info_init", node_vorbis_info_init);
   Nan::SetMethod(target, "vorbis_comment_init", node_vorbis_comment_init);
   Nan::SetMethod(target, "vorbis_synthesis_init", node_vorbis_synthesis_init);
+  Nan::SetMethod(target, "vorbis_synthesis_lowmem", node_vorbis_synthesis_lowmem);
   Nan::SetMethod(target, "vorbis_analysis_init", node_vorbis_analysis_init);
   Nan::SetMethod(target, "vorbis_block_init", node_vorbis_block_init);
   Nan::SetMethod(target, "vorbis_encode_init_vbr", node_vorbis_encode_init_vbr);
@@ -450,6 +785,8 @@ NAN_MODULE_INIT(Initialize) {
   Nan::SetMethod(target, "vorbis_analysis_write", node_vorbis_analysis_write);
   Nan::SetMethod(target, "vorbis_analysis_blockout", node_vorbis_analysis_blockout);
   Nan::SetMethod(target, "vorbis_analysis_eos", node_vorbis_analysis_eos);
+  Nan::SetMethod(target, "vorbis_analysis_transform", node_vorbis_analysis_transform);
+  Nan::SetMethod(target, "vorbis_analysis_ampmax", node_vorbis_analysis_ampmax);
   Nan::SetMethod(target, "vorbis_analysis", node_vorbis_analysis);
   Nan::SetMethod(target, "vorbis_bitrate_addblock", node_vorbis_bitrate_addblock);
   Nan::SetMethod(target, "vorbis_bitrate_flushpacket", node_vorbis_bitrate_flushpacket);
@@ -462,9 +799,15 @@ NAN_MODULE_INIT(Initialize) {
   /* custom functions */
   Nan::SetMethod(target, "comment_array", node_comment_array);
   Nan::SetMethod(target, "get_format", node_get_format);
+  Nan::SetMethod(target, "encode_parallel", node_encode_parallel);
+  Nan::SetMethod(target, "packet_list_get", node_packet_list_get);
+  Nan::SetMethod(target, "decode_parallel", node_decode_parallel);
+  Nan::SetMethod(target, "threadpool_stats", node_threadpool_stats);
 
   Nan::DefineOwnProperty(target, Nan::New<String>("version").ToLocalChecked(), Nan::New<String>(vorbis_version_string()).ToLocalChecked(),
     static_cast<PropertyAttribute>(ReadOnly|DontDelete));
+  Nan::DefineOwnProperty(target, Nan::New<String>("simd").ToLocalChecked(), Nan::New<String>(SIMD_STRING).ToLocalChecked(),
+    static_cast<PropertyAttribute>(ReadOnly|DontDelete));
 }
 
 } // nodevorbis namespace
@@ -0,0 +1,770 @@
+/*
+ * Copyright (c) 2012, Nathan Rajlich <nathan@tootallnate.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <string.h>
+#include <uv.h>
+
+#include "parallel.h"
+#include "vorbis/vorbisenc.h"
+
+namespace nodevorbis {
+
+/*
+ * Segmented encoding
+ * ------------------
+ *
+ * The input is cut into equal segments and every segment gets its own
+ * encoder, started at least `PREROLL_BLOCKS` long blocks before the segment's
+ * first frame and run `PREROLL_BLOCKS` long blocks past its last one, so that
+ * the envelope detector has settled by the time the encoders on either side
+ * of a boundary are both looking at the same audio.
+ *
+ * A Vorbis audio packet's granulepos is the center of its block, and a packet
+ * only depends on its neighbours through the block sizes (the previous and
+ * next window shapes are coded in the packet). So packet `i` of the left
+ * encoder may be followed by packet `j` of the right encoder when:
+ *
+ *   - left[i] and right[j - 1] are centered on the same frame,
+ *   - left[i] and right[j - 1] have the same block size, and
+ *   - left[i + 1] and right[j] have the same block size.
+ *
+ * Two encoders only ever agree on their block centers once they are on the
+ * same block grid, and a run of long blocks keeps whatever grid the encoder
+ * started out on. So before any real encoding happens, every segment does a
+ * cheap "layout" pass (`vorbis_analysis_blockout()` only, no analysis) to see
+ * where its blocks land. A segment whose blocks don't meet its left
+ * neighbour's has its start nudged back by the grid offset and its layout
+ * redone. Block placement doesn't depend on the analysis, so the joints found
+ * in the layouts are exactly where the encoded packets line up.
+ *
+ * If the layouts can't be made to meet, the input is encoded serially.
+ */
+
+#define PREROLL_BLOCKS 8
+#define SPLICE_BLOCKS 4
+#define FEED_SAMPLES 1024
+
+struct SegmentJob {
+  const float *pcm;
+  int channels;
+  long rate;
+  float quality;
+  long begin;    /* first input frame given to this encoder */
+  long end;      /* one past the last input frame given to this encoder */
+  bool headers;  /* also keep the 3 header packets */
+  bool analysis; /* false for a layout pass */
+
+  PacketList packets; /* headers first (if any), then one entry per block */
+  int rtn;
+};
+
+static void copy_packet(PacketList &list, ogg_packet *op, long blocksize,
+                        long offset) {
+  list.push_back(OwnedPacket());
+  OwnedPacket &p = list.back();
+  p.data.assign(op->packet, op->packet + op->bytes);
+  p.granulepos = op->granulepos + offset;
+  p.blocksize = blocksize;
+  p.eos = op->e_o_s != 0;
+}
+
+/* a layout entry: where the block is, but no packet data */
+static void copy_block(PacketList &list, vorbis_info *vi, vorbis_block *vb,
+                       long offset) {
+  list.push_back(OwnedPacket());
+  OwnedPacket &p = list.back();
+  p.granulepos = vb->granulepos + offset;
+  p.blocksize = vorbis_info_blocksize(vi, vb->W);
+  p.eos = vb->eofflag != 0;
+}
+
+/* the regular libvorbis encode loop, over frames [begin, end) of the input */
+static int encode_range(SegmentJob *job) {
+  vorbis_info vi;
+  vorbis_comment vc;
+  vorbis_dsp_state vd;
+  vorbis_block vb;
+  ogg_packet header, comments, code, op;
+  int channels = job->channels;
+  long pos = job->begin;
+  bool eos = false;
+  int r;
+
+  job->packets.clear();
+
+  vorbis_info_init(&vi);
+  r = vorbis_encode_init_vbr(&vi, channels, job->rate, job->quality);
+  if (r != 0) {
+    vorbis_info_clear(&vi);
+    return r;
+  }
+  if (vorbis_analysis_init(&vd, &vi) != 0) {
+    vorbis_dsp_clear(&vd);
+    vorbis_info_clear(&vi);
+    return OV_EFAULT;
+  }
+  if (vorbis_block_init(&vd, &vb) != 0) {
+    vorbis_dsp_clear(&vd);
+    vorbis_info_clear(&vi);
+    return OV_EFAULT;
+  }
+  vorbis_comment_init(&vc);
+
+  r = vorbis_analysis_headerout(&vd, &vc, &header, &comments, &code);
+  if (r == 0 && job->headers) {
+    copy_packet(job->packets, &header, 0, 0);
+    copy_packet(job->packets, &comments, 0, 0);
+    copy_packet(job->packets, &code, 0, 0);
+  }
+
+  while (r == 0 && !eos) {
+    if (pos < job->end) {
+      long n = job->end - pos;
+      if (n > FEED_SAMPLES) n = FEED_SAMPLES;
+
+      /* uninterleave samples */
+      float **buffer = vorbis_analysis_buffer(&vd, n);
+      const float *in = job->pcm + pos * channels;
+      for (long i = 0; i < n; i++) {
+        for (int j = 0; j < channels; j++) {
+          buffer[j][i] = in[i * channels + j];
+        }
+      }
+      vorbis_analysis_wrote(&vd, n);
+      pos += n;
+    } else {
+      vorbis_analysis_wrote(&vd, 0);
+    }
+
+    while (!eos && (r = vorbis_analysis_blockout(&vd, &vb)) == 1) {
+      if (!job->analysis) {
+        copy_block(job->packets, &vi, &vb, job->begin);
+        eos = vb.eofflag != 0;
+        continue;
+      }
+      vorbis_analysis(&vb, NULL);
+      vorbis_bitrate_addblock(&vb);
+      while (!eos && (r = vorbis_bitrate_flushpacket(&vd, &op)) == 1) {
+        copy_packet(job->packets, &op, vorbis_packet_blocksize(&vi, &op),
+                    job->begin);
+        eos = op.e_o_s != 0;
+      }
+      if (r < 0) break;
+    }
+    if (r > 0 || eos) r = 0;
+  }
+
+  vorbis_block_clear(&vb);
+  vorbis_dsp_clear(&vd);
+  vorbis_comment_clear(&vc);
+  vorbis_info_clear(&vi);
+  return r;
+}
+
+static void encode_segment(void *arg) {
+  SegmentJob *job = static_cast<SegmentJob *>(arg);
+  job->rtn = encode_range(job);
+}
+
+/* runs the given jobs, one thread each; returns the first error */
+static int run_jobs(std::vector<SegmentJob *> &jobs) {
+  std::vector<uv_thread_t> threads(jobs.size());
+  size_t started = 0;
+  size_t i;
+  int r = 0;
+  for (i = 0; i < jobs.size(); i++) {
+    if (uv_thread_create(&threads[i], encode_segment, jobs[i]) != 0) {
+      r = OV_EFAULT;
+      break;
+    }
+    started++;
+  }
+  for (i = 0; i < started; i++) {
+    uv_thread_join(&threads[i]);
+    if (r == 0) r = jobs[i]->rtn;
+  }
+  return r;
+}
+
+/* index of the packet in `list` centered on `granulepos`, or -1 */
+static long find_center(const PacketList &list, ogg_int64_t granulepos) {
+  for (long i = static_cast<long>(list.size()) - 1; i >= 0; i--) {
+    if (list[i].blocksize == 0 || list[i].granulepos < granulepos) break;
+    if (list[i].granulepos == granulepos) return i;
+  }
+  return -1;
+}
+
+/*
+ * Finds the joint between two neighbouring segments within frames
+ * [lo, hi]. On success `*left` is the last packet to keep from `a` and
+ * `*right` the first packet to keep from `b`.
+ */
+
+static bool find_joint(const PacketList &a, const PacketList &b,
+                       ogg_int64_t lo, ogg_int64_t hi,
+                       long *left, long *right) {
+  for (size_t j = 1; j < b.size(); j++) {
+    ogg_int64_t center = b[j - 1].granulepos;
+    if (b[j - 1].blocksize == 0 || center < lo) continue;
+    if (center > hi || b[j].eos) break;
+
+    long i = find_center(a, center);
+    if (i < 0 || static_cast<size_t>(i) + 1 >= a.size()) continue;
+    if (a[i].blocksize == b[j - 1].blocksize &&
+        a[i + 1].blocksize == b[j].blocksize) {
+      *left = i;
+      *right = static_cast<long>(j);
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * How far back `b` has to start for its blocks at frame `lo` to sit on the
+ * same grid as the blocks of `a`.
+ */
+
+static long grid_offset(const PacketList &a, const PacketList &b,
+                        ogg_int64_t lo, long blocksize) {
+  ogg_int64_t ca = -1, cb = -1;
+  size_t i;
+  long step = blocksize / 2; /* spacing of consecutive long blocks */
+
+  for (i = 0; i < b.size() && cb < 0; i++) {
+    if (b[i].blocksize != 0 && b[i].granulepos >= lo) cb = b[i].granulepos;
+  }
+  for (i = 0; i < a.size() && ca < 0; i++) {
+    if (a[i].blocksize != 0 && a[i].granulepos >= cb) ca = a[i].granulepos;
+  }
+  if (ca < 0 || cb < 0) return step / 2;
+
+  long shift = static_cast<long>((cb - ca) % step);
+  if (shift < 0) shift += step;
+  /* same grid, but the block sizes disagree; move off it and try again */
+  return shift ? shift : step / 2;
+}
+
+/* moves packets [from, to] of `src` onto the end of `dst` */
+static void append_packets(PacketList &dst, PacketList &src, long from, long to) {
+  for (long i = from; i <= to; i++) {
+    dst.push_back(OwnedPacket());
+    OwnedPacket &p = dst.back();
+    p.data.swap(src[i].data);
+    p.granulepos = src[i].granulepos;
+    p.blocksize = src[i].blocksize;
+    p.eos = src[i].eos;
+  }
+}
+
+static int encode_serial(const float *pcm, int channels, long rate,
+                         float quality, long samples, PacketList &out) {
+  SegmentJob job;
+  job.pcm = pcm;
+  job.channels = channels;
+  job.rate = rate;
+  job.quality = quality;
+  job.begin = 0;
+  job.end = samples;
+  job.headers = true;
+  job.analysis = true;
+  job.rtn = encode_range(&job);
+  out.swap(job.packets);
+  return job.rtn;
+}
+
+int encode_parallel(const float *pcm, int channels, long rate, float quality,
+                    long samples, int segments, PacketList &out, int *joints) {
+  vorbis_info vi;
+  long blocksize;
+  long preroll;
+  long length;
+  int r;
+  int k;
+
+  *joints = 0;
+  out.clear();
+
+  /* the segment layout is in units of the long blocksize */
+  vorbis_info_init(&vi);
+  r = vorbis_encode_init_vbr(&vi, channels, rate, quality);
+  blocksize = vorbis_info_blocksize(&vi, 1);
+  vorbis_info_clear(&vi);
+  if (r != 0) return r;
+
+  preroll = PREROLL_BLOCKS * blocksize;
+
+  /* a segment needs to be comfortably longer than its pre-roll to be worth
+   * its own thread */
+  if (segments > samples / (8 * preroll)) {
+    segments = static_cast<int>(samples / (8 * preroll));
+  }
+  if (segments < 2) {
+    return encode_serial(pcm, channels, rate, quality, samples, out);
+  }
+
+  length = (samples + segments - 1) / segments;
+  length = (length + blocksize - 1) / blocksize * blocksize;
+
+  std::vector<SegmentJob> jobs(segments);
+  std::vector<SegmentJob *> pending;
+  for (k = 0; k < segments; k++) {
+    SegmentJob &job = jobs[k];
+    long start = k * length;
+    long stop = (k + 1 == segments) ? samples : start + length;
+    job.pcm = pcm;
+    job.channels = channels;
+    job.rate = rate;
+    job.quality = quality;
+    job.begin = (k == 0) ? 0 : start - preroll;
+    job.end = (k + 1 == segments || stop + preroll > samples) ?
+        samples : stop + preroll;
+    job.headers = (k == 0);
+    job.analysis = false;
+    job.rtn = 0;
+    pending.push_back(&job);
+  }
+
+  /* keep packets [first[k], last[k]] of segment `k` */
+  std::vector<long> first(segments), last(segments);
+  std::vector<bool> moved(segments);
+
+  /* line up the block layouts. Moving one segment can throw off the joint
+   * with the segment after it, so allow for that to ripple along */
+  for (int round = 0; !pending.empty(); round++) {
+    if (round > 2 * segments) {
+      return encode_serial(pcm, channels, rate, quality, samples, out);
+    }
+    r = run_jobs(pending);
+    if (r != 0) return r;
+    pending.clear();
+
+    for (k = 1; k < segments; k++) {
+      moved[k] = false;
+      if (moved[k - 1]) continue; /* look again once it's been redone */
+      ogg_int64_t lo = k * length;
+      ogg_int64_t hi = jobs[k - 1].end - SPLICE_BLOCKS * blocksize;
+      if (find_joint(jobs[k - 1].packets, jobs[k].packets, lo, hi,
+                     &last[k - 1], &first[k])) continue;
+
+      jobs[k].begin -= grid_offset(jobs[k - 1].packets, jobs[k].packets,
+                                   lo, blocksize);
+      if (jobs[k].begin < 0) {
+        return encode_serial(pcm, channels, rate, quality, samples, out);
+      }
+      moved[k] = true;
+      pending.push_back(&jobs[k]);
+    }
+  }
+
+  /* now the real thing */
+  for (k = 0; k < segments; k++) {
+    jobs[k].analysis = true;
+    pending.push_back(&jobs[k]);
+  }
+  r = run_jobs(pending);
+  if (r != 0) return r;
+
+  first[0] = 3; /* skip the headers */
+  last[segments - 1] = static_cast<long>(jobs[segments - 1].packets.size()) - 1;
+  for (k = 1; k < segments; k++) {
+    ogg_int64_t lo = k * length;
+    ogg_int64_t hi = jobs[k - 1].end - SPLICE_BLOCKS * blocksize;
+    if (!find_joint(jobs[k - 1].packets, jobs[k].packets, lo, hi,
+                    &last[k - 1], &first[k]) ||
+        last[k - 1] < first[k - 1]) {
+      return encode_serial(pcm, channels, rate, quality, samples, out);
+    }
+  }
+
+  append_packets(out, jobs[0].packets, 0, 2);
+  for (k = 0; k < segments; k++) {
+    append_packets(out, jobs[k].packets, first[k], last[k]);
+  }
+  *joints = segments - 1;
+  return 0;
+}
+
+
+/*
+ * Page-range decoding
+ * -------------------
+ *
+ * The whole file is in memory, so its pages are read in place rather than
+ * being copied through an `ogg_sync_state`. A first pass only hops from page
+ * header to page header, collecting the pages of the Vorbis stream. The audio
+ * pages are then cut into ranges of about the same size in bytes, and each
+ * range is decoded on its own thread with its own `vorbis_dsp_state`.
+ *
+ * A range that starts at page `p` is first fed one pre-roll packet: the last
+ * packet that ends on page `p - 1`, which carries that page's granulepos. The
+ * decoder starts out in the state vorbis_synthesis_restart() leaves it in, so
+ * the pre-roll block produces no output but tells it exactly where in the
+ * stream it is, and the block after it is overlapped just like in a
+ * sequential decode. The range before ends with that same packet, so the
+ * outputs of the ranges are simply concatenated.
+ */
+
+#define PAGE_CONTINUED 0x01
+#define PAGE_BOS 0x02
+#define PAGE_EOS 0x04
+
+struct OggPage {
+  size_t header;   /* offset of the page header */
+  size_t body;     /* offset of the page body */
+  size_t size;     /* header and body */
+  int flags;
+  ogg_int64_t granulepos;
+  ogg_uint32_t serialno;
+  int segments;    /* number of lacing values */
+  int last_end;    /* last lacing value that ends a packet, or -1 */
+  int packets;     /* number of packets that end on this page */
+};
+
+static ogg_uint32_t read32(const unsigned char *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((ogg_uint32_t)p[3] << 24);
+}
+
+static void crc_init(ogg_uint32_t *table) {
+  for (int i = 0; i < 256; i++) {
+    ogg_uint32_t r = i << 24;
+    for (int j = 0; j < 8; j++) {
+      r = (r & 0x80000000UL) ? (r << 1) ^ 0x04c11db7UL : r << 1;
+    }
+    table[i] = r;
+  }
+}
+
+/* parses the page at `pos`; false if there isn't a valid one there */
+static bool read_page(const unsigned char *data, size_t length, size_t pos,
+                      const ogg_uint32_t *crc, OggPage *page) {
+  const unsigned char *h = data + pos;
+  size_t i;
+
+  if (length - pos < 27 || memcmp(h, "OggS", 4) != 0 || h[4] != 0) {
+    return false;
+  }
+  page->segments = h[26];
+  if (length - pos < 27 + static_cast<size_t>(page->segments)) return false;
+
+  page->header = pos;
+  page->body = pos + 27 + page->segments;
+  page->size = 27 + page->segments;
+  page->last_end = -1;
+  page->packets = 0;
+  for (i = 0; i < static_cast<size_t>(page->segments); i++) {
+    page->size += h[27 + i];
+    if (h[27 + i] < 255) {
+      page->last_end = static_cast<int>(i);
+      page->packets++;
+    }
+  }
+  if (length - pos < page->size) return false;
+
+  /* the checksum is computed with its own field zeroed */
+  ogg_uint32_t sum = 0;
+  for (i = 0; i < page->size; i++) {
+    unsigned char c = (i >= 22 && i < 26) ? 0 : h[i];
+    sum = (sum << 8) ^ crc[((sum >> 24) & 0xff) ^ c];
+  }
+  if (sum != read32(h + 22)) return false;
+
+  page->flags = h[5];
+  page->granulepos = h[13];
+  for (i = 12; i >= 6; i--) page->granulepos = (page->granulepos << 8) | h[i];
+  page->serialno = read32(h + 14);
+  return true;
+}
+
+/*
+ * Collects the pages of the first Vorbis stream in the file, up to and
+ * including its "eos" page. Anything that isn't a valid page is skipped over.
+ */
+
+static void find_pages(const unsigned char *data, size_t length,
+                       std::vector<OggPage> &pages) {
+  ogg_uint32_t crc[256];
+  OggPage page;
+  bool found = false;
+  ogg_uint32_t serialno = 0;
+  size_t pos = 0;
+
+  crc_init(crc);
+  while (pos < length) {
+    if (!read_page(data, length, pos, crc, &page)) {
+      /* lost sync; look for the next capture pattern */
+      const unsigned char *next = static_cast<const unsigned char *>(
+          memchr(data + pos + 1, 'O', length - pos - 1));
+      if (next == NULL) break;
+      pos = next - data;
+      continue;
+    }
+    pos += page.size;
+
+    if (!found) {
+      if (!(page.flags & PAGE_BOS) || page.size - (page.body - page.header) < 7 ||
+          memcmp(data + page.body, "\x01vorbis", 7) != 0) continue;
+      found = true;
+      serialno = page.serialno;
+    }
+    if (page.serialno != serialno) continue;
+    pages.push_back(page);
+    if (page.flags & PAGE_EOS) break;
+  }
+}
+
+/*
+ * Reassembles the packets of pages [first, last]. A packet that is continued
+ * from before `first` is skipped, and so is one that runs on past `last`.
+ * Packets that fit in one page point straight into `data`.
+ */
+
+class PacketReader {
+ public:
+  PacketReader(const unsigned char *data, const std::vector<OggPage> &pages,
+               size_t first, size_t last)
+    : data(data), pages(pages), page(first), last(last), packetno(0) {
+    enter_page();
+  }
+
+  /* the page the last packet returned by next() ended on */
+  size_t current_page() const { return page; }
+
+  bool next(ogg_packet *op) {
+    if (returned) {
+      partial.clear();
+      returned = false;
+    }
+    while (page <= last) {
+      const OggPage &pg = pages[page];
+      const unsigned char *lacing = data + pg.header + 27;
+      while (seg < pg.segments) {
+        int val = lacing[seg++];
+        pos += val;
+        if (val == 255) continue;
+
+        /* a packet ends here */
+        size_t start = fragment;
+        fragment = pos;
+        if (skip) {
+          skip = false;
+          continue;
+        }
+        if (partial.empty()) {
+          op->packet = const_cast<unsigned char *>(data) + start;
+          op->bytes = static_cast<long>(pos - start);
+        } else {
+          partial.insert(partial.end(), data + start, data + pos);
+          op->packet = &partial[0];
+          op->bytes = static_cast<long>(partial.size());
+          returned = true;
+        }
+        op->b_o_s = (pg.flags & PAGE_BOS) && start == pg.body;
+        op->e_o_s = (pg.flags & PAGE_EOS) && seg - 1 == pg.last_end;
+        op->granulepos = (seg - 1 == pg.last_end) ? pg.granulepos : -1;
+        op->packetno = packetno++;
+        return true;
+      }
+
+      /* the packet in progress carries on onto the next page */
+      if (!skip) partial.insert(partial.end(), data + fragment, data + pos);
+      if (page == last) break;
+      page++;
+      enter_page();
+    }
+    return false;
+  }
+
+ private:
+  void enter_page() {
+    const OggPage &pg = pages[page];
+    if (pg.flags & PAGE_CONTINUED) {
+      skip = partial.empty();
+    } else {
+      partial.clear();
+      skip = false;
+    }
+    seg = 0;
+    pos = fragment = pg.body;
+    returned = false;
+  }
+
+  const unsigned char *data;
+  const std::vector<OggPage> &pages;
+  size_t page;
+  size_t last;
+  int seg;
+  size_t pos;       /* read position in the current page's body */
+  size_t fragment;  /* where the current packet's bytes on this page begin */
+  bool skip;
+  bool returned;
+  std::vector<unsigned char> partial;
+  ogg_int64_t packetno;
+};
+
+struct RangeJob {
+  const unsigned char *data;
+  const std::vector<OggPage> *pages;
+  size_t first; /* page holding the pre-roll packet, or 0 */
+  size_t last;
+  vorbis_dsp_state vd;
+  vorbis_block vb;
+
+  std::vector<float> pcm; /* interleaved */
+  int rtn;
+};
+
+static int decode_range(RangeJob *job) {
+  vorbis_dsp_state *vd = &job->vd;
+  vorbis_block *vb = &job->vb;
+  int channels = vd->vi->channels;
+  PacketReader reader(job->data, *job->pages, job->first, job->last);
+  ogg_packet op;
+  int skip = (job->first == 0) ? 3 : 0; /* the headers */
+  float **pcm;
+  int samples;
+  int r;
+
+  while (reader.next(&op)) {
+    if (skip > 0) {
+      skip--;
+      continue;
+    }
+    if (job->first > 0 && reader.current_page() == job->first &&
+        op.granulepos == -1) {
+      /* not the pre-roll packet yet */
+      continue;
+    }
+
+    r = vorbis_synthesis(vb, &op);
+    if (r != 0) return r;
+    r = vorbis_synthesis_blockin(vd, vb);
+    if (r != 0) return r;
+
+    while ((samples = vorbis_synthesis_pcmout(vd, &pcm)) > 0) {
+      size_t base = job->pcm.size();
+      job->pcm.resize(base + samples * channels);
+      float *out = &job->pcm[base];
+      for (int i = 0; i < channels; i++) {
+        float *mono = pcm[i];
+        for (int j = 0; j < samples; j++) {
+          out[j * channels + i] = mono[j];
+        }
+      }
+      vorbis_synthesis_read(vd, samples);
+    }
+  }
+  return 0;
+}
+
+static void decode_segment(void *arg) {
+  RangeJob *job = static_cast<RangeJob *>(arg);
+  job->rtn = decode_range(job);
+}
+
+int decode_parallel(const unsigned char *data, size_t length,
+                    vorbis_info *vi, vorbis_comment *vc, int segments,
+                    std::vector<float> &out) {
+  std::vector<OggPage> pages;
+  std::vector<size_t> bounds; /* first page of each range */
+  ogg_packet op;
+  size_t first_audio;
+  size_t p;
+  int r;
+  int k;
+
+  find_pages(data, length, pages);
+  if (pages.empty()) return OV_ENOTVORBIS;
+
+  /* the 3 headers; the audio starts on a fresh page after them */
+  PacketReader headers(data, pages, 0, pages.size() - 1);
+  for (k = 0; k < 3; k++) {
+    if (!headers.next(&op)) return OV_EBADHEADER;
+    r = vorbis_synthesis_headerin(vi, vc, &op);
+    if (r != 0) return r;
+  }
+  first_audio = headers.current_page() + 1;
+
+  /* a range can start at page `p` if the last packet ending on page `p - 1`
+   * also starts there, so it can be read back as the pre-roll packet */
+  bounds.push_back(0);
+  if (segments > 1 && first_audio < pages.size()) {
+    size_t begin = pages[first_audio].header;
+    size_t total = pages.back().header + pages.back().size - begin;
+    k = 1;
+    for (p = first_audio + 1; p < pages.size() && k < segments; p++) {
+      const OggPage &prev = pages[p - 1];
+      if (pages[p].header - begin < total / segments * k) continue;
+      if (prev.packets == 0 || (prev.flags & PAGE_EOS) ||
+          ((prev.flags & PAGE_CONTINUED) && prev.packets < 2)) continue;
+      bounds.push_back(p);
+      k++;
+    }
+  }
+  segments = static_cast<int>(bounds.size());
+
+  std::vector<RangeJob> jobs(segments);
+  std::vector<uv_thread_t> threads(segments);
+  int ready = 0;   /* jobs with their decoder set up */
+  int started = 0; /* jobs with a thread */
+
+  /* vorbis_synthesis_init() builds the shared codebooks the first time
+   * around, so do these one by one */
+  r = 0;
+  for (k = 0; k < segments; k++) {
+    RangeJob &job = jobs[k];
+    job.data = data;
+    job.pages = &pages;
+    job.first = (k == 0) ? 0 : bounds[k] - 1;
+    job.last = (k + 1 == segments) ? pages.size() - 1 : bounds[k + 1] - 1;
+    job.rtn = 0;
+    if (vorbis_synthesis_init(&job.vd, vi) != 0) {
+      r = OV_EFAULT;
+      break;
+    }
+    if (vorbis_block_init(&job.vd, &job.vb) != 0) {
+      vorbis_dsp_clear(&job.vd);
+      r = OV_EFAULT;
+      break;
+    }
+    ready++;
+  }
+
+  for (k = 0; r == 0 && k < segments; k++) {
+    if (uv_thread_create(&threads[k], decode_segment, &jobs[k]) != 0) {
+      r = OV_EFAULT;
+      break;
+    }
+    started++;
+  }
+  for (k = 0; k < started; k++) {
+    uv_thread_join(&threads[k]);
+    if (r == 0) r = jobs[k].rtn;
+  }
+
+  for (k = 0; k < ready; k++) {
+    if (r == 0) {
+      out.insert(out.end(), jobs[k].pcm.begin(), jobs[k].pcm.end());
+    }
+    std::vector<float>().swap(jobs[k].pcm);
+    vorbis_block_clear(&jobs[k].vb);
+    vorbis_dsp_clear(&jobs[k].vd);
+  }
+  return r;
+}
+
+} // nodevorbis namespace
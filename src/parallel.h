@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2012, Nathan Rajlich <nathan@tootallnate.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Whole-buffer encode/decode jobs that are split across several threads.
+ * Nothing in here touches V8, so it is safe to call from a worker thread.
+ */
+
+#ifndef NODE_VORBIS_PARALLEL_H_
+#define NODE_VORBIS_PARALLEL_H_
+
+#include <vector>
+
+#include "ogg/ogg.h"
+#include "vorbis/codec.h"
+
+namespace nodevorbis {
+
+/*
+ * An `ogg_packet` whose bytes belong to us rather than to libvorbis.
+ */
+
+struct OwnedPacket {
+  std::vector<unsigned char> data;
+  ogg_int64_t granulepos;
+  long blocksize; /* 0 for header packets */
+  bool eos;
+};
+
+typedef std::vector<OwnedPacket> PacketList;
+
+/*
+ * Encodes `samples` frames of interleaved float PCM as one logical Vorbis
+ * stream (the 3 header packets followed by every audio packet) into `out`.
+ *
+ * The input is cut into `segments` pieces that are encoded concurrently, each
+ * with its own `vorbis_dsp_state`, and the packet runs are spliced back
+ * together afterwards. `*joints` receives the number of segment boundaries
+ * that were spliced; if any boundary can't be spliced the whole input is
+ * encoded serially instead and `*joints` is 0.
+ *
+ * Returns 0 on success or a libvorbis `OV_*` error code.
+ */
+
+int encode_parallel(const float *pcm, int channels, long rate, float quality,
+                    long samples, int segments, PacketList &out, int *joints);
+
+/*
+ * Decodes the first Vorbis stream in an in-memory Ogg file to interleaved
+ * float PCM, appended to `out`. `vi` and `vc` must have been initialized and
+ * are filled in from the stream's headers.
+ *
+ * The audio pages are split into `segments` page ranges that are decoded
+ * concurrently; the output is the same as decoding the stream in one go.
+ *
+ * Returns 0 on success or a libvorbis `OV_*` error code.
+ */
+
+int decode_parallel(const unsigned char *data, size_t length,
+                    vorbis_info *vi, vorbis_comment *vc, int segments,
+                    std::vector<float> &out);
+
+} // nodevorbis namespace
+
+#endif // NODE_VORBIS_PARALLEL_H_
@@ -0,0 +1,48 @@
+
+/**
+ * Module dependencies.
+ */
+
+var assert = require('assert');
+var bufferAlloc = require('buffer-alloc');
+
+/**
+ * Synthetic test audio shared by the tests, as interleaved 32-bit float PCM:
+ * two tones per channel under a slow swell, and a click now and then for
+ * some short blocks. The Encoder's golden hashes are of this signal, so it
+ * mustn't change.
+ *
+ * @param {Number} channels
+ * @param {Number} samples sample frames
+ * @return {Buffer} PCM audio data
+ * @api public
+ */
+
+exports.signal = function (channels, samples) {
+  var pcm = bufferAlloc(samples * channels * 4);
+  for (var i = 0; i < samples; i++) {
+    for (var c = 0; c < channels; c++) {
+      var s = 0.3 * Math.sin(i * (0.01 + c * 0.003)) + 0.1 * Math.sin(i * 0.2 * (1 + c));
+      if (i % 30000 < 100) s += 0.4 * Math.sin(i * 1.3);
+      pcm.writeFloatLE(s * (0.5 + 0.5 * Math.sin(i * 0.0001)), (i * channels + c) * 4);
+    }
+  }
+  return pcm;
+};
+
+/**
+ * Asserts that two lists of `ogg_packet`s are the same, byte for byte.
+ *
+ * @param {Array} a
+ * @param {Array} b
+ * @api public
+ */
+
+exports.assertSamePackets = function (a, b) {
+  assert.equal(a.length, b.length);
+  for (var i = 0; i < a.length; i++) {
+    assert.equal(a[i].granulepos, b[i].granulepos);
+    assert.equal(a[i].bytes, b[i].bytes);
+    assert.ok(a[i].packet.slice(0, a[i].bytes).equals(b[i].packet.slice(0, b[i].bytes)), 'packet ' + i + ' differs');
+  }
+};
@@ -8,10 +8,54 @@ var ogg = require('ogg');
 var path = require('path');
 var vorbis = require('../');
 var assert = require('assert');
+var crypto = require('crypto');
 var fixtures = path.resolve(__dirname, 'fixtures');
 
 describe('Decoder', function () {
 
+  // SHA-1 of the decoded PCM data, pinned so that changes to the DSP code
+  // can't alter the output unnoticed. The hashes are of little-endian
+  // floats as produced on x64; other platforms may legitimately round
+  // differently (fused multiply-adds), so the check only runs there
+  var golden = process.arch === 'x64' ? it : it.skip;
+
+  function decode (fixture, serialno, opts, fn) {
+    var buffers = [];
+    var od = new ogg.Decoder();
+    od.on('stream', function (stream) {
+      if (serialno != null && stream.serialno != serialno) return stream.resume(); // flow..
+
+      var vd = new vorbis.Decoder(opts);
+      vd.on('data', function (b) { buffers.push(b); });
+      vd.on('error', fn);
+      vd.on('end', function () {
+        fn(null, Buffer.concat(buffers));
+      });
+      stream.pipe(vd);
+    });
+    fs.createReadStream(fixture).pipe(od);
+  }
+
+  // the packets of the first logical stream in `fixture`
+  function packets (fixture, fn) {
+    var list = [];
+    var od = new ogg.Decoder();
+    od.once('stream', function (stream) {
+      stream.on('data', function (packet) {
+        // the bytes belong to the demuxer until copied
+        packet.replace();
+        list.push(packet);
+      });
+      stream.on('end', function () { fn(null, list); });
+    });
+    od.on('error', fn);
+    fs.createReadStream(fixture).pipe(od);
+  }
+
+  function sha1 (buf) {
+    return crypto.createHash('sha1').update(buf).digest('hex');
+  }
+
   describe('pipershut_lo.ogg', function () {
     var fixture = path.resolve(fixtures, 'pipershut_lo.ogg');
 
@@ -70,6 +114,103 @@ describe('Decoder', function () {
       fs.createReadStream(fixture).pipe(od);
     });
 
+    it('should output the same PCM data with `blocks: 4`', function (done) {
+      this.test.slow(15000);
+      this.test.timeout(20000);
+
+      decode(fixture, null, {}, function (err, a) {
+        if (err) return done(err);
+        decode(fixture, null, { blocks: 4 }, function (err, b) {
+          if (err) return done(err);
+          assert.equal(a.length, b.length);
+          assert.ok(a.equals(b), 'PCM data differs');
+          done();
+        });
+      });
+    });
+
+    it('should output the same PCM data with `lowmem: true`', function (done) {
+      this.test.slow(15000);
+      this.test.timeout(20000);
+
+      decode(fixture, null, {}, function (err, a) {
+        if (err) return done(err);
+        decode(fixture, null, { lowmem: true }, function (err, b) {
+          if (err) return done(err);
+          assert.equal(a.length, b.length);
+          assert.ok(a.equals(b), 'PCM data differs');
+          done();
+        });
+      });
+    });
+
+    it('should output the float PCM data rounded to 16 bits with `bitDepth: 16`', function (done) {
+      this.test.slow(15000);
+      this.test.timeout(20000);
+
+      decode(fixture, null, {}, function (err, a) {
+        if (err) return done(err);
+        decode(fixture, null, { bitDepth: 16 }, function (err, b) {
+          if (err) return done(err);
+          assert.equal(a.length / 2, b.length);
+          for (var i = 0; i < b.length / 2; i++) {
+            // round half to even, then clip
+            var v = a.readFloatLE(i * 4) * 32768;
+            var r = Math.round(v);
+            if (r - v === 0.5 && r % 2 !== 0) r--;
+            r = Math.max(-32768, Math.min(32767, r));
+            if (b.readInt16LE(i * 2) !== r) return done(new Error('sample ' + i + ' is ' + b.readInt16LE(i * 2) + ', not ' + r));
+          }
+          done();
+        });
+      });
+    });
+
+    it('should skip a bad packet and keep decoding', function (done) {
+      this.test.slow(15000);
+      this.test.timeout(20000);
+
+      decode(fixture, null, {}, function (err, a) {
+        if (err) return done(err);
+        packets(fixture, function (err, list) {
+          if (err) return done(err);
+          var buffers = [];
+          var errors = 0;
+          var vd = new vorbis.Decoder();
+          vd.on('data', function (b) { buffers.push(b); });
+          vd.on('error', function () { errors++; });
+          vd.on('end', function () {
+            // the stray header packet fails synthesis and adds nothing
+            assert.equal(1, errors);
+            var b = Buffer.concat(buffers);
+            assert.equal(a.length, b.length);
+            assert.ok(a.equals(b), 'PCM data differs');
+            done();
+          });
+
+          // a second comment header, right after the first audio packet
+          list.splice(4, 0, list[1]);
+          var i = 0;
+          (function write () {
+            if (i >= list.length) return vd.end();
+            vd.write(list[i++], write);
+          })();
+        });
+      });
+    });
+
+    golden('should output the expected PCM data', function (done) {
+      this.test.slow(8000);
+      this.test.timeout(10000);
+
+      decode(fixture, null, {}, function (err, pcm) {
+        if (err) return done(err);
+        assert.equal(804096 * 2 * 4, pcm.length);
+        assert.equal('39a6c0f3e3ee4453084a1a05eabffec597fd75d6', sha1(pcm));
+        done();
+      });
+    });
+
   });
 
   describe('Rooster_crowing_small.ogg', function () {
@@ -129,6 +270,15 @@ describe('Decoder', function () {
       fs.createReadStream(fixture).pipe(od);
     });
 
+    golden('should output the expected PCM data', function (done) {
+      decode(fixture, serialno, {}, function (err, pcm) {
+        if (err) return done(err);
+        assert.equal(119069 * 4, pcm.length);
+        assert.equal('83dea534fcab44c182b4154a17c453d08a22553c', sha1(pcm));
+        done();
+      });
+    });
+
   });
 
 });
@@ -0,0 +1,88 @@
+
+/**
+ * Module dependencies.
+ */
+
+var vorbis = require('../');
+var assert = require('assert');
+var crypto = require('crypto');
+var common = require('./common');
+
+describe('Encoder', function () {
+  var channels = 2;
+  var sampleRate = 44100;
+
+  // 3 seconds of audio
+  var samples = sampleRate * 3;
+  var pcm = common.signal(channels, samples);
+
+  function encode (opts, fn) {
+    var ve = new vorbis.Encoder(opts);
+    var packets = [];
+    ve.on('data', function (packet) { packets.push(packet); });
+    ve.on('error', fn);
+    ve.on('end', function () {
+      fn(null, packets);
+    });
+
+    // write the PCM data in 16kb chunks
+    for (var offset = 0; offset < pcm.length; offset += 16384) {
+      ve.write(pcm.slice(offset, offset + 16384));
+    }
+    ve.end();
+  }
+
+  // SHA-1 of the audio packets for the PCM data above, pinned so that
+  // changes to the encoder can't alter its output unnoticed. Like the
+  // Decoder's golden tests, only checked on x64
+  var golden = process.arch === 'x64' ? it : it.skip;
+
+  [
+    [ -0.1, '4850de7ab204c160c003024310f200badf81a935' ],
+    [ 0.0, '759267fcd5d7879da8f7838b1c2c14fe3740e5cc' ],
+    [ 0.1, '84a5bfd199f1281d8d9da966b2f79eaae2b6724a' ],
+    [ 0.2, 'ed65274ea77d2c53dc995feb9e648bcaddea6785' ],
+    [ 0.3, '2f3c9c8949c35085a9903d2a1e490fc07e38b780' ],
+    [ 0.4, '56f1203f4f748e5cfecd40b7a90e0363e537847a' ],
+    [ 0.5, 'e248813e74e0d2068c2be97a688a567857355f3d' ],
+    [ 0.6, '0112e6edad55efaebb2550e32993b4285b96bfbf' ],
+    [ 0.7, '2dc16627848e6c4553e5896cabc6ca9567bcdac1' ],
+    [ 0.8, '429dc77c980d832634e01dad8b198483055d5cef' ],
+    [ 0.9, '5d234661a8ada15f498f61fb368828cddfc7b8ba' ],
+    [ 1.0, '95d272fcf5a19e92e3b1e4dd08a290cfde56cf23' ]
+  ].forEach(function (t) {
+    var quality = t[0];
+    var expected = t[1];
+
+    golden('should output the expected packets at quality ' + quality, function (done) {
+      this.test.slow(8000);
+      this.test.timeout(20000);
+
+      encode({ quality: quality }, function (err, packets) {
+        if (err) return done(err);
+        var hash = crypto.createHash('sha1');
+        // skip the 3 header packets, the comment header has the vendor string
+        for (var i = 3; i < packets.length; i++) {
+          hash.update(packets[i].packet.slice(0, packets[i].bytes));
+        }
+        assert.equal(expected, hash.digest('hex'));
+        done();
+      });
+    });
+  });
+
+  it('should output the same packets with `blocks: 4`', function (done) {
+    this.test.slow(8000);
+    this.test.timeout(20000);
+
+    encode({}, function (err, a) {
+      if (err) return done(err);
+      encode({ blocks: 4 }, function (err, b) {
+        if (err) return done(err);
+        common.assertSamePackets(a, b);
+        done();
+      });
+    });
+  });
+
+});
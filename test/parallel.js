@@ -0,0 +1,180 @@
+
+/**
+ * Module dependencies.
+ */
+
+var fs = require('fs');
+var ogg = require('ogg');
+var path = require('path');
+var vorbis = require('../');
+var assert = require('assert');
+var common = require('./common');
+var fixtures = path.resolve(__dirname, 'fixtures');
+
+describe('encodeParallel()', function () {
+  var channels = 2;
+  var sampleRate = 44100;
+
+  // 10 seconds of audio, long enough to be split into 3 segments
+  var samples = sampleRate * 10;
+  var pcm = common.signal(channels, samples);
+
+  function decode (packets, fn) {
+    var vd = new vorbis.Decoder();
+    var buffers = [];
+    vd.on('data', function (b) { buffers.push(b); });
+    vd.on('error', fn);
+    vd.on('end', function () {
+      fn(null, Buffer.concat(buffers));
+    });
+    packets.forEach(function (packet) {
+      vd.write(packet);
+    });
+    vd.end();
+  }
+
+  // signal-to-noise ratio of `decoded` against `input` over sample frames
+  // [from, to), in dB
+  function snr (input, decoded, from, to) {
+    var signal = 0;
+    var noise = 0;
+    for (var i = from * channels * 4; i < to * channels * 4; i += 4) {
+      var a = input.readFloatLE(i);
+      var e = decoded.readFloatLE(i) - a;
+      signal += a * a;
+      noise += e * e;
+    }
+    return 10 * Math.log(signal / noise) / Math.LN10;
+  }
+
+  // encodes `input` on 1 thread and on 4, and checks that the parallel encode
+  // is as good as the serial one, overall and in every window of 4 long
+  // blocks, which catches a bad segment joint that the whole-signal figure
+  // would average away
+  function compare (input, fn) {
+    var frames = input.length / channels / 4;
+    var window = 4 * 2048;
+    vorbis.encodeParallel(input, { threads: 1 }, function (err, serial) {
+      if (err) return fn(err);
+      vorbis.encodeParallel(input, { threads: 4 }, function (err, parallel) {
+        if (err) return fn(err);
+        decode(serial, function (err, a) {
+          if (err) return fn(err);
+          decode(parallel, function (err, b) {
+            if (err) return fn(err);
+            assert.equal(input.length, a.length);
+            assert.equal(input.length, b.length);
+            var sa = snr(input, a, 0, frames);
+            var sb = snr(input, b, 0, frames);
+            assert(Math.abs(sa - sb) < 0.1, 'SNR ' + sa + ' vs ' + sb);
+            for (var from = 0; from < frames; from += window) {
+              var to = Math.min(from + window, frames);
+              sa = snr(input, a, from, to);
+              sb = snr(input, b, from, to);
+              assert(sb > sa - 0.5, 'SNR ' + sa + ' vs ' + sb + ' at sample frames ' + from + '-' + to);
+            }
+            fn();
+          });
+        });
+      });
+    });
+  }
+
+  it('should output the 3 header packets first', function (done) {
+    this.test.slow(8000);
+    this.test.timeout(20000);
+
+    vorbis.encodeParallel(pcm, { threads: 4 }, function (err, packets) {
+      if (err) return done(err);
+      assert.equal(1, packets[0].b_o_s);
+      assert.equal(1, packets[0].packet[0]); // identification header
+      assert.equal(3, packets[1].packet[0]); // comment header
+      assert.equal(5, packets[2].packet[0]); // setup header
+      assert.equal(true, packets[2].flush);
+      assert.equal(true, packets[3].pageout);
+      assert.equal(1, packets[packets.length - 1].e_o_s);
+      done();
+    });
+  });
+
+  it('should decode to the same number of samples as the input', function (done) {
+    this.test.slow(8000);
+    this.test.timeout(20000);
+
+    vorbis.encodeParallel(pcm, { threads: 4 }, function (err, packets) {
+      if (err) return done(err);
+      decode(packets, function (err, decoded) {
+        if (err) return done(err);
+        assert.equal(pcm.length, decoded.length);
+        done();
+      });
+    });
+  });
+
+  // the quality-equivalence check: segment joints must not cost anything
+  // measurable compared to encoding the whole input on one thread
+  it('should be as good as a single-threaded encode', function (done) {
+    this.test.slow(15000);
+    this.test.timeout(40000);
+    compare(pcm, done);
+  });
+
+  it('should be as good as a single-threaded encode when the segments are uneven', function (done) {
+    this.test.slow(15000);
+    this.test.timeout(40000);
+
+    // 439999 sample frames: a multiple of neither the 3 segments nor the
+    // long blocksize
+    compare(pcm.slice(0, (samples - 1001) * channels * 4), done);
+  });
+
+});
+
+describe('decodeParallel()', function () {
+
+  describe('pipershut_lo.ogg', function () {
+    var fixture = path.resolve(fixtures, 'pipershut_lo.ogg');
+
+    it('should output the same PCM data as the Decoder class', function (done) {
+      this.test.slow(8000);
+      this.test.timeout(20000);
+
+      var buffers = [];
+      var od = new ogg.Decoder();
+      od.on('stream', function (stream) {
+        var vd = new vorbis.Decoder();
+        vd.on('data', function (b) { buffers.push(b); });
+        vd.on('end', function () {
+          var expected = Buffer.concat(buffers);
+          vorbis.decodeParallel(fs.readFileSync(fixture), { threads: 4 }, function (err, pcm, format) {
+            if (err) return done(err);
+            assert.equal(2, format.channels);
+            assert.equal(expected.length, pcm.length);
+            assert.ok(expected.equals(pcm), 'PCM data differs');
+            done();
+          });
+        });
+        stream.pipe(vd);
+      });
+      fs.createReadStream(fixture).pipe(od);
+    });
+
+  });
+
+  describe('Rooster_crowing_small.ogg', function () {
+    var fixture = path.resolve(fixtures, 'Rooster_crowing_small.ogg');
+
+    it('should find the vorbis stream out of 3 ogg streams', function (done) {
+      vorbis.decodeParallel(fs.readFileSync(fixture), { threads: 4 }, function (err, pcm, format, comments) {
+        if (err) return done(err);
+        assert.equal(1, format.channels);
+        assert.equal(22050, format.sampleRate);
+        assert.equal(119069 * 4, pcm.length);
+        assert.equal('ENCODER=ffmpeg2theora-0.26', comments[0]);
+        done();
+      });
+    });
+
+  });
+
+});
@@ -0,0 +1,399 @@
+#!/usr/bin/env node
+
+/**
+ * Times the `Encoder` and `Decoder` streams end to end:
+ *
+ *   $ npm run bench -- [--json] [--seconds=N] [encode] [decode]
+ *
+ * The encoder runs on synthetic input over a range of channel counts,
+ * qualities and chunk sizes; the decoder on the packets of those encodes and
+ * of the files in test/fixtures. The input is made (and the fixtures demuxed)
+ * before the clock starts, so only the streams themselves are timed. Chunks
+ * (packets, for the decoder) are written one at a time, each as soon as the
+ * previous one has been taken, and the output is read as it comes.
+ *
+ * For each run the result has:
+ *
+ *  - `realtime`: seconds of audio per second of wall time
+ *  - `latencyMs`: percentiles of the time from writing a chunk to its write
+ *    callback, i.e. until the stream is ready for the next one
+ *  - `eventLoopDelayMs`: how late timers ran while the stream was busy
+ *  - `gcMs` and `gcCount`: garbage collection during the run
+ *  - `mainThreadMs`: time the event loop was busy, which is the JS side plus
+ *    the synchronous binding calls; the analysis and synthesis themselves run
+ *    on the thread pool, and are most of the rest of `cpuMs`
+ *
+ * Needs node 14.10 or newer for the event loop figures, which are `null`
+ * otherwise. `--json` prints all of it as one JSON document.
+ */
+
+var fs = require('fs');
+var path = require('path');
+var ogg = require('ogg');
+var vorbis = require('../');
+var signal = require('./signal');
+
+var perf = null;
+try { perf = require('perf_hooks'); } catch (e) {}
+
+var fixtures = path.resolve(__dirname, '..', 'test', 'fixtures');
+
+var channelCounts = [ 1, 2, 6 ];
+var qualities = [ 0.1, 0.4, 0.9 ];
+var chunkFrames = [ 256, 1024, 4096, 16384 ];
+var sampleRate = 44100;
+
+var opts = { json: false, seconds: 10, encode: true, decode: true };
+process.argv.slice(2).forEach(function (arg) {
+  var m;
+  if (arg === '--json') opts.json = true;
+  else if ((m = /^--seconds=(.+)$/.exec(arg))) opts.seconds = +m[1];
+  else if (arg === 'encode') opts.decode = false;
+  else if (arg === 'decode') opts.encode = false;
+  else {
+    console.error('usage: bench.js [--json] [--seconds=N] [encode] [decode]');
+    process.exit(1);
+  }
+});
+
+var results = [];
+
+series(plan(), function (err) {
+  if (err) throw err;
+  if (opts.json) {
+    console.log(JSON.stringify({
+      node: process.version,
+      simd: vorbis.simd,
+      seconds: opts.seconds,
+      results: results
+    }, null, 2));
+  }
+});
+
+/**
+ * The runs, as a list of functions taking a callback.
+ */
+
+function plan () {
+  var steps = [];
+
+  // a short encode and decode first, so the JIT has settled before timing
+  steps.push(function (done) {
+    encodePackets(2, 0.4, 1, function (err, packets) {
+      if (err) return done(err);
+      var vd = new vorbis.Decoder();
+      vd.on('data', function () {});
+      vd.on('error', done);
+      vd.on('end', done);
+      packets.forEach(function (packet) { vd.write(packet); });
+      vd.end();
+    });
+  });
+
+  channelCounts.forEach(function (channels) {
+    qualities.forEach(function (quality) {
+      if (opts.encode) {
+        steps.push(function (done) {
+          var pcm = signal(channels, sampleRate, opts.seconds);
+          series(chunkFrames.map(function (frames) {
+            return function (next) {
+              var config = {
+                channels: channels,
+                sampleRate: sampleRate,
+                quality: quality,
+                chunkFrames: frames
+              };
+              timeEncode(pcm, config, next);
+            };
+          }), done);
+        });
+      }
+      if (opts.decode) {
+        steps.push(function (done) {
+          encodePackets(channels, quality, opts.seconds, function (err, packets) {
+            if (err) return done(err);
+            var input = { input: 'synthetic', quality: quality };
+            timeDecode(packets, input, done);
+          });
+        });
+      }
+    });
+  });
+
+  if (opts.decode) {
+    fs.readdirSync(fixtures).filter(function (f) {
+      return /\.ogg$/.test(f);
+    }).forEach(function (file) {
+      steps.push(function (done) {
+        demux(path.join(fixtures, file), function (err, streams) {
+          if (err) return done(err);
+          series(streams.map(function (s) {
+            return function (next) {
+              timeDecode(s.packets, { input: file + '#' + s.serialno }, next);
+            };
+          }), done);
+        });
+      });
+    });
+  }
+
+  return steps;
+}
+
+/**
+ * Encodes `pcm` in chunks of `config.chunkFrames` sample frames.
+ */
+
+function timeEncode (pcm, config, fn) {
+  var ve = new vorbis.Encoder(config);
+  var chunk = config.chunkFrames * config.channels * 4;
+  var offset = 0;
+  var run = start();
+
+  ve.on('data', function () {});
+  ve.on('error', fn);
+  ve.on('end', function () {
+    run.stop(function (r) {
+      r.mode = 'encode';
+      r.input = 'synthetic';
+      r.channels = config.channels;
+      r.sampleRate = config.sampleRate;
+      r.quality = config.quality;
+      r.chunkFrames = config.chunkFrames;
+      r.seconds = pcm.length / 4 / config.channels / config.sampleRate;
+      finish(r, fn);
+    });
+  });
+
+  (function write () {
+    if (offset >= pcm.length) return ve.end();
+    var t = process.hrtime();
+    ve.write(pcm.slice(offset, offset + chunk), function (err) {
+      if (err) return;
+      run.chunk(t);
+      write();
+    });
+    offset += chunk;
+  })();
+}
+
+/**
+ * Decodes a list of packets, header packets first. A stream that isn't Vorbis
+ * (Rooster_crowing_small.ogg has Theora and Skeleton ones as well) fails on
+ * its first packet and is left out.
+ */
+
+function timeDecode (packets, input, fn) {
+  var vd = new vorbis.Decoder();
+  var format = null;
+  var bytes = 0;
+  var i = 0;
+  var run = start();
+
+  vd.on('format', function (f) { format = f; });
+  vd.on('data', function (b) { bytes += b.length; });
+  vd.on('error', function (err) {
+    run.stop(function () { fn(format ? err : null); });
+  });
+  vd.on('end', function () {
+    run.stop(function (r) {
+      r.mode = 'decode';
+      r.input = input.input;
+      r.channels = format.channels;
+      r.sampleRate = format.sampleRate;
+      r.quality = input.quality == null ? null : input.quality;
+      r.chunkFrames = null;
+      r.seconds = bytes / (format.bitDepth / 8) / format.channels / format.sampleRate;
+      finish(r, fn);
+    });
+  });
+
+  (function write () {
+    if (i >= packets.length) return vd.end();
+    var t = process.hrtime();
+    vd.write(packets[i++], function (err) {
+      if (err) return;
+      run.chunk(t);
+      write();
+    });
+  })();
+}
+
+// the packets of an encode of the synthetic signal, untimed
+function encodePackets (channels, quality, seconds, fn) {
+  var pcm = signal(channels, sampleRate, seconds);
+  var ve = new vorbis.Encoder({ channels: channels, sampleRate: sampleRate, quality: quality });
+  var packets = [];
+  ve.on('data', function (packet) { packets.push(packet); });
+  ve.on('error', fn);
+  ve.on('end', function () { fn(null, packets); });
+  ve.end(pcm);
+}
+
+// the packets of each logical stream in an Ogg file
+function demux (file, fn) {
+  var od = new ogg.Decoder();
+  var streams = [];
+  var pending = 1;
+  function done () {
+    if (--pending === 0) fn(null, streams);
+  }
+  od.on('stream', function (stream) {
+    var s = { serialno: stream.serialno, packets: [] };
+    streams.push(s);
+    pending++;
+    stream.on('data', function (packet) {
+      // the bytes belong to the demuxer until copied
+      if (typeof packet.replace === 'function') packet.replace();
+      s.packets.push(packet);
+    });
+    stream.on('end', done);
+  });
+  od.on('error', fn);
+  od.on('finish', done);
+  fs.createReadStream(file).pipe(od);
+}
+
+/**
+ * Measurement of one run: wall time, per-chunk latency, event loop delay and
+ * utilization, GC and CPU time.
+ */
+
+var gc = { count: 0, ms: 0 };
+if (perf && perf.PerformanceObserver) {
+  try {
+    new perf.PerformanceObserver(function (list) {
+      list.getEntries().forEach(function (entry) {
+        gc.count++;
+        gc.ms += entry.duration;
+      });
+    }).observe({ entryTypes: [ 'gc' ] });
+  } catch (e) {
+    gc = null;
+  }
+} else {
+  gc = null;
+}
+
+function start () {
+  var latency = [];
+  var delay = null;
+  var elu = null;
+  if (perf && perf.monitorEventLoopDelay) {
+    delay = perf.monitorEventLoopDelay({ resolution: 10 });
+    delay.enable();
+  }
+  if (perf && perf.performance && perf.performance.eventLoopUtilization) {
+    elu = perf.performance.eventLoopUtilization();
+  }
+  var gcCount = gc && gc.count;
+  var gcMs = gc && gc.ms;
+  var cpu = process.cpuUsage ? process.cpuUsage() : null;
+  var begin = process.hrtime();
+
+  return {
+    chunk: function (t) {
+      latency.push(ms(process.hrtime(t)));
+    },
+    // calls back with the figures once GC entries, which are delivered
+    // asynchronously, have come in
+    stop: function (fn) {
+      var r = { wallMs: ms(process.hrtime(begin)) };
+      latency.sort(function (a, b) { return a - b; });
+      r.chunks = latency.length;
+      r.latencyMs = {
+        p50: percentile(latency, 50),
+        p90: percentile(latency, 90),
+        p99: percentile(latency, 99),
+        max: latency.length ? latency[latency.length - 1] : null
+      };
+      if (delay) {
+        delay.disable();
+        r.eventLoopDelayMs = {
+          mean: delay.mean / 1e6,
+          p99: delay.percentile(99) / 1e6,
+          max: delay.max / 1e6
+        };
+      } else {
+        r.eventLoopDelayMs = null;
+      }
+      r.mainThreadMs = elu ? perf.performance.eventLoopUtilization(elu).active : null;
+      if (cpu) {
+        cpu = process.cpuUsage(cpu);
+        r.cpuMs = (cpu.user + cpu.system) / 1000;
+      } else {
+        r.cpuMs = null;
+      }
+      setImmediate(function () {
+        r.gcCount = gc ? gc.count - gcCount : null;
+        r.gcMs = gc ? gc.ms - gcMs : null;
+        fn(r);
+      });
+    }
+  };
+}
+
+function finish (r, fn) {
+  r.realtime = r.seconds / (r.wallMs / 1000);
+  results.push(order(r));
+  if (!opts.json) print(r);
+  fn();
+}
+
+// the same key order for every result, so they diff cleanly
+function order (r) {
+  var keys = [ 'mode', 'input', 'channels', 'sampleRate', 'quality',
+    'chunkFrames', 'seconds', 'wallMs', 'realtime', 'chunks', 'latencyMs',
+    'eventLoopDelayMs', 'gcMs', 'gcCount', 'mainThreadMs', 'cpuMs' ];
+  var o = {};
+  keys.forEach(function (k) { o[k] = r[k]; });
+  return o;
+}
+
+var header = false;
+function print (r) {
+  if (!header) {
+    console.log('mode    input                          ch  q    chunk  x rt    ' +
+      'p50 ms  p99 ms  eld p99  gc ms  main %');
+    header = true;
+  }
+  console.log([
+    pad(r.mode, 6, true),
+    pad(r.input, 30, true),
+    pad(String(r.channels), 2),
+    pad(r.quality == null ? '-' : r.quality.toFixed(1), 3),
+    pad(r.chunkFrames == null ? '-' : String(r.chunkFrames), 6),
+    pad(r.realtime.toFixed(1), 6),
+    pad(fixed(r.latencyMs.p50, 2), 7),
+    pad(fixed(r.latencyMs.p99, 2), 7),
+    pad(r.eventLoopDelayMs ? fixed(r.eventLoopDelayMs.p99, 1) : '-', 8),
+    pad(fixed(r.gcMs, 1), 6),
+    pad(r.mainThreadMs == null ? '-' : (r.mainThreadMs / r.wallMs * 100).toFixed(0), 6)
+  ].join('  '));
+}
+
+function percentile (sorted, p) {
+  if (!sorted.length) return null;
+  return sorted[Math.min(sorted.length - 1, Math.ceil(p / 100 * sorted.length) - 1)];
+}
+
+function fixed (n, digits) {
+  return n == null ? '-' : n.toFixed(digits);
+}
+
+function pad (s, n, left) {
+  while (s.length < n) s = left ? s + ' ' : ' ' + s;
+  return s;
+}
+
+function ms (d) {
+  return d[0] * 1e3 + d[1] / 1e6;
+}
+
+function series (steps, fn) {
+  var i = 0;
+  (function next (err) {
+    if (err || i >= steps.length) return fn(err);
+    steps[i++](next);
+  })();
+}
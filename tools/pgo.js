@@ -0,0 +1,229 @@
+#!/usr/bin/env node
+
+/**
+ * Rebuilds node-vorbis with link-time and profile-guided optimization:
+ *
+ *   $ npm run pgo
+ *
+ *  1. the default build is made and timed on the training workload below
+ *  2. an instrumented build (`--vorbis_lto=1 --vorbis_pgo=generate`) runs the
+ *     workload once, writing out its profile
+ *  3. the final build (`--vorbis_lto=1 --vorbis_pgo=use`) is made from that
+ *     profile, timed on the same workload and left in place of the default one
+ *
+ * The workload encodes a few synthetic signals over a range of channel counts
+ * and qualities, decodes them again, and decodes the files in test/fixtures.
+ * The optimization only reorders and inlines code, so the output is the same
+ * as the default build's. Run `npm rebuild` to go back to that.
+ *
+ * Needs GCC or clang (plus `llvm-profdata`); MSVC is not supported.
+ */
+
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+var spawnSync = require('child_process').spawnSync;
+var signal = require('./signal');
+
+var root = path.resolve(__dirname, '..');
+var fixtures = path.resolve(root, 'test', 'fixtures');
+
+// number of times each build is timed, the best run counts
+var runs = 3;
+
+if (process.argv[2] === 'train') {
+  train(function (err, result) {
+    if (err) throw err;
+    console.log(JSON.stringify(result));
+  });
+} else {
+  main();
+}
+
+function main () {
+  if (process.platform === 'win32') {
+    console.error('pgo: profile-guided builds need GCC or clang');
+    process.exit(1);
+  }
+
+  var dir = path.join(os.tmpdir(), 'node-vorbis-pgo-' + process.pid);
+  var opt = [ '--vorbis_lto=1', '--vorbis_pgo_dir=' + dir ];
+
+  rebuild([]);
+  var before = measure();
+
+  rmdir(dir);
+  fs.mkdirSync(dir);
+  rebuild(opt.concat('--vorbis_pgo=generate'));
+  workload();
+  merge(dir);
+
+  rebuild(opt.concat('--vorbis_pgo=use'));
+  var after = measure();
+  rmdir(dir);
+
+  console.log();
+  console.log('               default    lto+pgo');
+  report('encode', before.encode, after.encode);
+  report('decode', before.decode, after.decode);
+}
+
+function report (name, before, after) {
+  console.log('%s  %sx rt  %sx rt   %s%%', name, pad(before.toFixed(1), 7),
+    pad(after.toFixed(1), 7), ((after / before - 1) * 100).toFixed(1));
+}
+
+function pad (s, n) {
+  while (s.length < n) s = ' ' + s;
+  return s;
+}
+
+function run (cmd, args) {
+  console.log('pgo: %s %s', path.basename(cmd), args.join(' '));
+  var r = spawnSync(cmd, args, { cwd: root, stdio: [ 'ignore', 'pipe', 'inherit' ] });
+  if (r.error) throw r.error;
+  if (r.status !== 0) {
+    process.stdout.write(r.stdout);
+    throw new Error(path.basename(cmd) + ' exited with ' + r.status);
+  }
+  return r.stdout.toString();
+}
+
+function rebuild (args) {
+  // npm points us at its own copy of node-gyp when run as `npm run pgo`
+  var gyp = process.env.npm_config_node_gyp;
+  if (gyp) run(process.execPath, [ gyp, 'rebuild' ].concat(args));
+  else run('node-gyp', [ 'rebuild' ].concat(args));
+}
+
+// runs the workload in a fresh process, so it loads the build just made
+function workload () {
+  return JSON.parse(run(process.execPath, [ __filename, 'train' ]));
+}
+
+// best of `runs` runs, in multiples of real time
+function measure () {
+  var best = { encode: 0, decode: 0 };
+  for (var i = 0; i < runs; i++) {
+    var r = workload();
+    best.encode = Math.max(best.encode, r.encode);
+    best.decode = Math.max(best.decode, r.decode);
+  }
+  return best;
+}
+
+// clang writes raw profiles that have to be merged into the one that
+// `-fprofile-use=<dir>` looks for; GCC's can be used as they are
+function merge (dir) {
+  var raw = fs.readdirSync(dir).filter(function (f) {
+    return /\.profraw$/.test(f);
+  }).map(function (f) {
+    return path.join(dir, f);
+  });
+  if (raw.length === 0) return;
+  var args = [ 'merge', '-output=' + path.join(dir, 'default.profdata') ].concat(raw);
+  if (process.platform === 'darwin') run('xcrun', [ 'llvm-profdata' ].concat(args));
+  else run('llvm-profdata', args);
+}
+
+function rmdir (dir) {
+  if (!fs.existsSync(dir)) return;
+  fs.readdirSync(dir).forEach(function (f) {
+    var p = path.join(dir, f);
+    if (fs.statSync(p).isDirectory()) rmdir(p);
+    else fs.unlinkSync(p);
+  });
+  fs.rmdirSync(dir);
+}
+
+/**
+ * The training workload. Calls back with the encode and decode speeds, in
+ * seconds of audio per second.
+ */
+
+function train (fn) {
+  var vorbis = require('../');
+  var ogg = require('ogg');
+
+  var configs = [
+    { channels: 1, sampleRate: 22050, quality: 0.1 },
+    { channels: 2, sampleRate: 44100, quality: 0.4 },
+    { channels: 2, sampleRate: 44100, quality: 0.9 },
+    { channels: 6, sampleRate: 48000, quality: 0.6 }
+  ];
+  var files = fs.readdirSync(fixtures).filter(function (f) {
+    return /\.ogg$/.test(f);
+  });
+  var result = { encode: 0, decode: 0 };
+  var time = { encode: 0, decode: 0 };
+  var audio = { encode: 0, decode: 0 };
+
+  function next () {
+    if (configs.length > 0) return synthetic(configs.shift(), next);
+    if (files.length > 0) return fixture(files.shift(), next);
+    result.encode = audio.encode / time.encode;
+    result.decode = audio.decode / time.decode;
+    fn(null, result);
+  }
+
+  function synthetic (config, done) {
+    var seconds = 5;
+    var pcm = signal(config.channels, config.sampleRate, seconds);
+    var packets = [];
+    var ve = new vorbis.Encoder(config);
+    var start = process.hrtime();
+    ve.on('data', function (packet) { packets.push(packet); });
+    ve.on('error', fn);
+    ve.on('end', function () {
+      time.encode += elapsed(start);
+      audio.encode += seconds;
+
+      var vd = new vorbis.Decoder();
+      start = process.hrtime();
+      vd.on('data', function () {});
+      vd.on('error', fn);
+      vd.on('end', function () {
+        time.decode += elapsed(start);
+        audio.decode += seconds;
+        done();
+      });
+      packets.forEach(function (packet) { vd.write(packet); });
+      vd.end();
+    });
+    for (var offset = 0; offset < pcm.length; offset += 16384) {
+      ve.write(pcm.slice(offset, offset + 16384));
+    }
+    ve.end();
+  }
+
+  function fixture (file, done) {
+    var od = new ogg.Decoder();
+    var start = process.hrtime();
+    var pending = 0;
+    od.on('stream', function (stream) {
+      var vd = new vorbis.Decoder();
+      var format;
+      var bytes = 0;
+      pending++;
+      vd.on('format', function (f) { format = f; });
+      vd.on('data', function (b) { bytes += b.length; });
+      vd.on('error', fn);
+      vd.on('end', function () {
+        audio.decode += bytes / 4 / format.channels / format.sampleRate;
+        if (--pending === 0) {
+          time.decode += elapsed(start);
+          done();
+        }
+      });
+      stream.pipe(vd);
+    });
+    fs.createReadStream(path.join(fixtures, file)).pipe(od);
+  }
+
+  next();
+}
+
+function elapsed (start) {
+  var d = process.hrtime(start);
+  return d[0] + d[1] / 1e9;
+}
@@ -0,0 +1,279 @@
+#!/usr/bin/env node
+
+/**
+ * Runs N `Encoder`s or `Decoder`s at once, for N from 1 up to 10,000, to show
+ * how the module copes with many concurrent streams:
+ *
+ *   $ npm run scale -- [--json] [--lowmem] [--seconds=N] [--counts=1,10,100] [encode] [decode]
+ *
+ * Every stream gets `seconds` (default 1) of the same synthetic stereo audio,
+ * written in chunks of 4096 sample frames (one packet at a time, for the
+ * decoders), each as soon as the stream has taken the previous one. All N
+ * are started together and the run ends when the last one does.
+ *
+ * For each N the result has:
+ *
+ *  - `realtime`: seconds of audio per second of wall time, over all streams
+ *  - `rssPerStreamKB`: the growth of the process RSS at its peak, per stream
+ *  - `threadpool`: the jobs the streams queued, how long they waited for a
+ *    thread on average and at most, and how many were pending at once
+ *  - `eventLoopDelayMs`: how late timers ran during the run
+ *  - `latencyMs`: percentiles of the time from writing a chunk to its write
+ *    callback
+ *
+ * The thread pool has `UV_THREADPOOL_SIZE` threads (4 unless set). Run with
+ * `node --expose-gc` so that the garbage of one run is collected before the
+ * next one's baseline RSS is taken. 10,000 encoders need several GB of
+ * memory; `--counts` picks smaller steps. `--lowmem` gives the decoders the
+ * `lowmem` option, for comparing RSS per stream.
+ */
+
+var vorbis = require('../');
+var binding = require('../lib/binding');
+var signal = require('./signal');
+
+var perf = null;
+try { perf = require('perf_hooks'); } catch (e) {}
+
+var channels = 2;
+var sampleRate = 44100;
+var quality = 0.4;
+var chunkFrames = 4096;
+
+var opts = {
+  json: false,
+  lowmem: false,
+  seconds: 1,
+  counts: [ 1, 10, 100, 1000, 10000 ],
+  encode: true,
+  decode: true
+};
+process.argv.slice(2).forEach(function (arg) {
+  var m;
+  if (arg === '--json') opts.json = true;
+  else if (arg === '--lowmem') opts.lowmem = true;
+  else if ((m = /^--seconds=(.+)$/.exec(arg))) opts.seconds = +m[1];
+  else if ((m = /^--counts=(.+)$/.exec(arg))) opts.counts = m[1].split(',').map(Number);
+  else if (arg === 'encode') opts.decode = false;
+  else if (arg === 'decode') opts.encode = false;
+  else {
+    console.error('usage: scale.js [--json] [--lowmem] [--seconds=N] [--counts=N,...] [encode] [decode]');
+    process.exit(1);
+  }
+});
+
+var pcm = signal(channels, sampleRate, opts.seconds);
+var results = [];
+
+encodePackets(function (err, packets) {
+  if (err) throw err;
+  var steps = [];
+  [ 'encode', 'decode' ].forEach(function (mode) {
+    if (!opts[mode]) return;
+    opts.counts.forEach(function (n) {
+      steps.push(function (done) {
+        run(mode, n, packets, done);
+      });
+    });
+  });
+  series(steps, function (err) {
+    if (err) throw err;
+    if (opts.json) {
+      console.log(JSON.stringify({
+        node: process.version,
+        simd: vorbis.simd,
+        threadpoolSize: +process.env.UV_THREADPOOL_SIZE || 4,
+        seconds: opts.seconds,
+        lowmem: opts.lowmem,
+        results: results
+      }, null, 2));
+    }
+  });
+});
+
+/**
+ * One run: `n` streams of `mode` at once.
+ */
+
+function run (mode, n, packets, fn) {
+  if (global.gc) global.gc();
+  setImmediate(function () {
+    var rss = process.memoryUsage().rss;
+    var peakRss = rss;
+    var peakPending = 0;
+    var latency = [];
+    var left = n;
+    var failed = null;
+
+    var delay = null;
+    if (perf && perf.monitorEventLoopDelay) {
+      delay = perf.monitorEventLoopDelay({ resolution: 10 });
+      delay.enable();
+    }
+    var pool = binding.threadpool_stats(true);
+    var begin = process.hrtime();
+
+    // RSS and the thread pool queue between callbacks
+    var sampler = setInterval(function () {
+      peakRss = Math.max(peakRss, process.memoryUsage().rss);
+      peakPending = Math.max(peakPending, binding.threadpool_stats().pending);
+    }, 50);
+
+    function end (err) {
+      if (err && !failed) failed = err;
+      if (--left > 0) return;
+
+      var wallMs = ms(process.hrtime(begin));
+      clearInterval(sampler);
+      peakRss = Math.max(peakRss, process.memoryUsage().rss);
+      var after = binding.threadpool_stats(true);
+      if (delay) delay.disable();
+      if (failed) return fn(failed);
+
+      latency.sort(function (a, b) { return a - b; });
+      var works = after.works - pool.works;
+      var r = {
+        mode: mode,
+        streams: n,
+        seconds: n * opts.seconds,
+        wallMs: wallMs,
+        realtime: n * opts.seconds / (wallMs / 1000),
+        rssMB: peakRss / 1048576,
+        rssPerStreamKB: (peakRss - rss) / 1024 / n,
+        threadpool: {
+          works: works,
+          meanWaitMs: works ? (after.waitMs - pool.waitMs) / works : null,
+          maxWaitMs: after.maxWaitMs,
+          peakPending: peakPending
+        },
+        eventLoopDelayMs: delay ? {
+          mean: delay.mean / 1e6,
+          p99: delay.percentile(99) / 1e6,
+          max: delay.max / 1e6
+        } : null,
+        latencyMs: {
+          p50: percentile(latency, 50),
+          p99: percentile(latency, 99),
+          max: latency.length ? latency[latency.length - 1] : null
+        }
+      };
+      results.push(r);
+      if (!opts.json) print(r);
+      fn();
+    }
+
+    for (var i = 0; i < n; i++) {
+      if (mode === 'encode') encoder(latency, end);
+      else decoder(packets, latency, end);
+    }
+  });
+}
+
+function encoder (latency, fn) {
+  var once = callOnce(fn);
+  var ve = new vorbis.Encoder({ channels: channels, sampleRate: sampleRate, quality: quality });
+  var chunk = chunkFrames * channels * 4;
+  var offset = 0;
+
+  ve.on('data', function () {});
+  ve.on('error', once);
+  ve.on('end', once);
+
+  (function write () {
+    if (offset >= pcm.length) return ve.end();
+    var t = process.hrtime();
+    ve.write(pcm.slice(offset, offset + chunk), function (err) {
+      if (err) return;
+      latency.push(ms(process.hrtime(t)));
+      write();
+    });
+    offset += chunk;
+  })();
+}
+
+function decoder (packets, latency, fn) {
+  var once = callOnce(fn);
+  var vd = new vorbis.Decoder({ lowmem: opts.lowmem });
+  var i = 0;
+
+  vd.on('data', function () {});
+  vd.on('error', once);
+  vd.on('end', once);
+
+  (function write () {
+    if (i >= packets.length) return vd.end();
+    var t = process.hrtime();
+    vd.write(packets[i++], function (err) {
+      if (err) return;
+      latency.push(ms(process.hrtime(t)));
+      write();
+    });
+  })();
+}
+
+// the decoders' input: the packets of one encode of `pcm`, shared by all
+function encodePackets (fn) {
+  var ve = new vorbis.Encoder({ channels: channels, sampleRate: sampleRate, quality: quality });
+  var packets = [];
+  ve.on('data', function (packet) { packets.push(packet); });
+  ve.on('error', fn);
+  ve.on('end', function () { fn(null, packets); });
+  ve.end(pcm);
+}
+
+var header = false;
+function print (r) {
+  if (!header) {
+    console.log('mode    streams   x rt  RSS MB  KB/stream  ' +
+      'jobs     wait ms  max wait  pending  eld p99  p99 ms');
+    header = true;
+  }
+  console.log([
+    pad(r.mode, 6, true),
+    pad(String(r.streams), 7),
+    pad(r.realtime.toFixed(1), 6),
+    pad(r.rssMB.toFixed(0), 6),
+    pad(r.rssPerStreamKB.toFixed(0), 9),
+    pad(String(r.threadpool.works), 8, true),
+    pad(fixed(r.threadpool.meanWaitMs, 2), 7),
+    pad(fixed(r.threadpool.maxWaitMs, 1), 8),
+    pad(String(r.threadpool.peakPending), 7),
+    pad(r.eventLoopDelayMs ? fixed(r.eventLoopDelayMs.p99, 1) : '-', 7),
+    pad(fixed(r.latencyMs.p99, 1), 6)
+  ].join('  '));
+}
+
+function callOnce (fn) {
+  var called = false;
+  return function (err) {
+    if (called) return;
+    called = true;
+    fn(err);
+  };
+}
+
+function percentile (sorted, p) {
+  if (!sorted.length) return null;
+  return sorted[Math.min(sorted.length - 1, Math.ceil(p / 100 * sorted.length) - 1)];
+}
+
+function fixed (n, digits) {
+  return n == null ? '-' : n.toFixed(digits);
+}
+
+function pad (s, n, left) {
+  while (s.length < n) s = left ? s + ' ' : ' ' + s;
+  return s;
+}
+
+function ms (d) {
+  return d[0] * 1e3 + d[1] / 1e6;
+}
+
+function series (steps, fn) {
+  var i = 0;
+  (function next (err) {
+    if (err || i >= steps.length) return fn(err);
+    steps[i++](next);
+  })();
+}
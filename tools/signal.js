@@ -0,0 +1,36 @@
+
+/**
+ * Module dependencies.
+ */
+
+var bufferAlloc = require('buffer-alloc');
+
+/**
+ * Synthetic test audio for the tools: tones, a sweep, noise and the odd click
+ * (for short blocks), as interleaved 32-bit float PCM. The same arguments
+ * always give the same samples.
+ *
+ * @param {Number} channels
+ * @param {Number} sampleRate
+ * @param {Number} seconds
+ * @return {Buffer} PCM audio data
+ * @api public
+ */
+
+module.exports = function signal (channels, sampleRate, seconds) {
+  var samples = Math.round(sampleRate * seconds);
+  var pcm = bufferAlloc(samples * channels * 4);
+  var seed = 1;
+  for (var i = 0; i < samples; i++) {
+    var t = i / sampleRate;
+    for (var c = 0; c < channels; c++) {
+      seed = (Math.imul(seed, 1103515245) + 12345) & 0x7fffffff;
+      var s = 0.2 * Math.sin(2 * Math.PI * (220 + 110 * c) * t) +
+        0.1 * Math.sin(2 * Math.PI * (100 + 2000 * t) * t) +
+        0.05 * (seed / 0x40000000 - 1);
+      if (i % 20000 < 64) s += 0.4 * Math.sin(i * 1.3);
+      pcm.writeFloatLE(s, (i * channels + c) * 4);
+    }
+  }
+  return pcm;
+};